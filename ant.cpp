@@ -1,13 +1,9 @@
 #include "includes/utils/ant.h"
 
 //Constructor
-Ant::Ant(const Custom_CDT& initial_cdt): ant_cdt(initial_cdt), ant_energy(0.0), DeltaE(0.0), ant_conflict(false),
-    ant_reduce_obtuses(false), num_of_obtuses(-1), ant_steiner_point(0,0), ant_steiner_method(NUM_METHODS),
-    longest_edge(Point_2(0, 0), Point_2(0, 0)), opposite_edge(Point_2(0, 0), Point_2(0, 0)){}
-
 Ant::Ant() :
-    ant_cdt(Custom_CDT()),
     ant_steiner_method(NUM_METHODS),  //Member initializer list for initialization
+    ant_steiner_point(0, 0),
     ant_energy(0.0),
     DeltaE(0.0),
     num_of_obtuses(-1),
@@ -17,28 +13,16 @@ Ant::Ant() :
     opposite_edge(Point_2(0, 0), Point_2(0, 0)) {
 }
 
-//Copy Constructor
-Ant::Ant(const Ant& other): ant_cdt(other.ant_cdt), ant_energy(other.ant_energy), DeltaE(other.DeltaE), 
-    ant_conflict(other.ant_conflict), ant_reduce_obtuses(other.ant_reduce_obtuses), 
-    num_of_obtuses(other.num_of_obtuses), ant_steiner_point(other.ant_steiner_point), 
-    ant_steiner_method(other.ant_steiner_method), ant_affect_faces(other.ant_affect_faces),
-    longest_edge(other.longest_edge), opposite_edge(other.opposite_edge) {   
-}
-
-void Ant::set_Custom_CDT(Custom_CDT& new_cdt) {
-    ant_cdt = new_cdt;
+void Ant::set_affected_faces(Face_key_set in_affected_faces) {
+    ant_affect_faces = std::move(in_affected_faces);
 }
 
-void Ant::set_face_in_ant_affect_faces(const Face_handle& face) {
-    ant_affect_faces.insert(face);
-}
-
-void Ant::initialize_Ants(vector<Ant>& ants, Custom_CDT& best_cdt){
+void Ant::initialize_Ants(vector<Ant>& ants){
     int count_ants = ants.size();
     Point_2 temp_steiner_point(0,0);
     Segment_2 default_edge(Point_2(0, 0), Point_2(0, 0));
     for (int i = 0; i < count_ants; ++i) {
-        ants[i] = Ant(best_cdt);
+        ants[i] = Ant();
         ants[i].set_energy(0.0);
         ants[i].set_DeltaE(0.0);
         ants[i].set_reduce_obtuses(false);
@@ -96,7 +80,7 @@ void Ant::set_opposite_edge_projection(Segment_2 in_opposite_edge){
 
 
 ///////////////Getters
-std::set<Face_handle>& Ant::get_affected_faces(){
+const Face_key_set& Ant::get_affected_faces() const {
     return ant_affect_faces;
 }
 
@@ -104,10 +88,6 @@ SteinerMethod Ant::get_steiner_method() const {
     return ant_steiner_method;
 }
 
-Custom_CDT& Ant::get_Custom_CDT(){
-    return ant_cdt;
-}
-
 Segment_2 Ant::get_longest_edge_midpoint() const{
     return longest_edge;
 }
@@ -0,0 +1,234 @@
+#include "includes/utils/solver.h"
+#include "includes/utils/functions_task1.h"
+#include <chrono>
+#include <filesystem>
+
+using namespace boost::json;
+using namespace std;
+using K = CGAL::Exact_predicates_exact_constructions_kernel;
+using Custom_CDT = Custom_Constrained_Delaunay_triangulation_2<K>;
+using std_string = std::string;
+namespace fs = std::filesystem;
+
+//Benchmark of the algorithms over a directory of instances (tests by default).
+//Every instance runs local_search, simulated_annealing, ant_colony and run_task1 (single threaded, same seed)
+//and for every run we report the wall time, the steiner points, the obtuse count and the time of the phases
+//(only with OPT_TRIANGULATION_PHASE_TIMERS).
+//./bench_triangulation [-d tests] [-o bench_results.json] [-s seed]
+//With --compare-flips it checks that start_the_flips gives the triangulation of the flips of the first version instead
+//(see compare_flips) and returns 1 if an instance differs.
+
+static const char* algorithms[] = {"local", "sa", "ant", "task1"};
+//Steiner insertions of compare_flips for every instance
+static const size_t compare_insertions = 16;
+
+//One run of an algorithm on a fresh triangulation of the instance
+static object bench_run(Instance& instance, const std_string& algorithm, unsigned int seed) {
+    Custom_CDT custom_cdt;
+    Polygon polygon;
+    build_triangulation(instance, custom_cdt, polygon);
+    int initial_vertexes = count_vertices(custom_cdt);
+    int initial_obtuses = count_obtuse_triangles(custom_cdt, polygon);
+    Rng_context rng_context(seed);
+    int L = instance.L;
+
+    instrumentation_begin();
+    Phase_times& times = phase_times();
+    times.reset();
+    times.enabled = true;
+    auto start = chrono::steady_clock::now();
+    if (algorithm == "task1") {
+        run_task1(custom_cdt, polygon);
+    }
+    else {
+        start_the_flips(custom_cdt, polygon);
+        if (algorithm == "local") local_search(custom_cdt, polygon, L);
+        else if (algorithm == "sa") simulated_annealing(custom_cdt, polygon, L, instance.alpha, instance.beta, instance.batch_size, rng_context.generator(), false);
+        else ant_colony(custom_cdt, polygon, instance.alpha, instance.beta, instance.chi, instance.psi, instance.lamda, L, instance.kappa, 1, rng_context);
+    }
+    double wall_time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    times.enabled = false;
+
+    object run;
+    run["algorithm"] = algorithm;
+    run["wall_time"] = wall_time;
+    run["initial_obtuse_count"] = initial_obtuses;
+    run["obtuse_count"] = count_obtuse_triangles(custom_cdt, polygon);
+    run["steiner_points"] = count_vertices(custom_cdt) - initial_vertexes;
+#ifdef OPT_TRIANGULATION_PHASE_TIMERS
+    object phases;
+    phases["flips"] = times.seconds[PHASE_FLIPS];
+    phases["counting"] = times.seconds[PHASE_COUNTING];
+    phases["insertion"] = times.seconds[PHASE_INSERTION];
+    run["phases"] = phases;
+#endif
+    //Counters of the hot operations (empty without OPT_TRIANGULATION_INSTRUMENTATION)
+    run["instrumentation"] = parse(instrumentation_json());
+    instrumentation_end();
+    return run;
+}
+
+//The flips of the first version: a scan of finite_edges that flips the first edge that is worth it and starts again
+static void reference_flips(Custom_CDT& cdt, const Polygon& polygon) {
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        for (auto edge = cdt.finite_edges_begin(); edge != cdt.finite_edges_end(); ++edge) {
+            Face_handle f1 = edge->first;
+            int i = edge->second;
+            Face_handle f2 = f1->neighbor(i);
+            if (cdt.is_infinite(f1) || cdt.is_infinite(f2)) continue;
+
+            Point_2 p1 = f1->vertex(cdt.ccw(i))->point();
+            Point_2 p3 = f1->vertex(cdt.cw(i))->point();
+            Point_2 p2 = f1->vertex(i)->point();
+            if (!is_edge_inside_region(p1, p3, polygon)) continue;
+            Point_2 p4 = f2->vertex(cdt.mirror_index(f1, i))->point();
+            if (cdt.is_constrained(*edge) || is_edge_on_boundary(p1, p3, polygon)) continue;
+
+            if (is_it_worth_flip(p1, p2, p3, p4)) {
+                cdt.flip(f1, i);
+                progress = true;
+                break;
+            }
+        }
+    }
+}
+
+//The edges of a cdt by their points (the same in every copy)
+static set<pair<Point_2, Point_2>> edges_of(const Custom_CDT& cdt) {
+    set<pair<Point_2, Point_2>> edges;
+    for (auto edge = cdt.finite_edges_begin(); edge != cdt.finite_edges_end(); ++edge) {
+        Point_2 a = edge->first->vertex(cdt.ccw(edge->second))->point();
+        Point_2 b = edge->first->vertex(cdt.cw(edge->second))->point();
+        if (b < a) swap(a, b);
+        edges.emplace(a, b);
+    }
+    return edges;
+}
+
+//start_the_flips against reference_flips, both on the same cdt: the reference runs in a transaction that is rolled back,
+//so the engine starts from the same faces in the same places of the face container (the order of finite_edges depends
+//on them, a copy of the cdt can have an other order). First the flips of the initial cdt, then the centroids of some
+//obtuse faces, each one with the seeded flips (start_the_flips with the steiner) against a full scan
+static object compare_flips(const Instance& instance) {
+    Custom_CDT engine_cdt;
+    Polygon polygon;
+    build_triangulation(instance, engine_cdt, polygon);
+    engine_cdt.begin_transaction();
+    reference_flips(engine_cdt, polygon);
+    set<pair<Point_2, Point_2>> reference_edges = edges_of(engine_cdt);
+    int reference_obtuses = count_obtuse_triangles(engine_cdt, polygon);
+    engine_cdt.rollback_transaction();
+    start_the_flips(engine_cdt, polygon);
+
+    object result;
+    bool same_flips = reference_edges == edges_of(engine_cdt);
+    result["same_flips"] = same_flips;
+    result["reference_obtuse_count"] = reference_obtuses;
+    result["obtuse_count"] = count_obtuse_triangles(engine_cdt, polygon);
+
+    vector<Point_2> centroids;
+    for (const Face_handle& face : engine_cdt.obtuse_faces()) {
+        if (centroids.size() == compare_insertions) break;
+        if (!engine_cdt.is_in_region(face)) continue;
+        centroids.push_back(CGAL::centroid(face->vertex(0)->point(), face->vertex(1)->point(), face->vertex(2)->point()));
+    }
+    int same_insertions = 0;
+    for (const Point_2& centroid : centroids) {
+        engine_cdt.begin_transaction();
+        engine_cdt.insert_no_flip(centroid);
+        reference_flips(engine_cdt, polygon);
+        reference_edges = edges_of(engine_cdt);
+        engine_cdt.rollback_transaction();
+        //The rollback frees the new faces in the reverse order, so the same insertion gets the same places again.
+        //engine_cdt is settled, so only the faces around the steiner are seeded
+        engine_cdt.begin_transaction();
+        Vertex_handle steiner = engine_cdt.insert_no_flip(centroid);
+        start_the_flips(engine_cdt, polygon, steiner);
+        if (reference_edges == edges_of(engine_cdt)) same_insertions++;
+        engine_cdt.rollback_transaction();
+    }
+    result["insertions"] = centroids.size();
+    result["same_insertions"] = same_insertions;
+    result["same"] = same_flips && same_insertions == static_cast<int>(centroids.size());
+    return result;
+}
+
+int main(int argc, char** argv) {
+    std_string input_dir = "tests", output_path = "bench_results.json";
+    unsigned int seed = 1;
+    bool compare = false;
+    //Parse command-line arguments
+    for (int i = 1; i < argc; ++i) {
+        if (std_string(argv[i]) == "-d" && i + 1 < argc) {
+            input_dir = argv[++i];
+        } else if (std_string(argv[i]) == "-o" && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (std_string(argv[i]) == "-s" && i + 1 < argc) {
+            seed = strtoul(argv[++i], nullptr, 10);
+        } else if (std_string(argv[i]) == "--compare-flips") {
+            compare = true;
+        }
+    }
+
+    vector<fs::path> inputs;
+    error_code error;
+    for (const auto& entry : fs::directory_iterator(input_dir, error)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".json") inputs.push_back(entry.path());
+    }
+    if (error) {
+        cerr<<"Cannot read the directory "<<input_dir<<": "<<error.message()<<endl;
+        return 1;
+    }
+    sort(inputs.begin(), inputs.end());
+
+    boost::json::array results;
+    int different = 0;
+    for (const auto& input : inputs) {
+        Instance instance;
+        try {
+            if (!read_instance(input.string(), instance)) continue;
+        }
+        catch (const exception& e) {
+            cerr<<"Error in "<<input<<": "<<e.what()<<endl;
+            continue;
+        }
+        object instance_result;
+        instance_result["instance"] = input.filename().string();
+        instance_result["points"] = instance.points.size();
+        if (compare) {
+            object comparison = compare_flips(instance);
+            bool same = comparison["same"].as_bool();
+            if (!same) different++;
+            cerr<<"compare-flips: "<<input.filename().string()<<(same ? " same" : " different")<<endl;
+            instance_result["compare_flips"] = comparison;
+            results.push_back(instance_result);
+            continue;
+        }
+        boost::json::array runs;
+        for (const char* algorithm : algorithms) {
+            cerr<<"bench: "<<input.filename().string()<<" "<<algorithm<<endl;
+            runs.push_back(bench_run(instance, algorithm, seed));
+        }
+        instance_result["runs"] = runs;
+        results.push_back(instance_result);
+    }
+
+    object bench;
+    bench["seed"] = seed;
+    bench["results"] = results;
+    ofstream file(output_path);
+    if (!file) {
+        cerr<<"Cannot write "<<output_path<<endl;
+        return 1;
+    }
+    file<<serialize(bench)<<endl;
+    cerr<<"bench: "<<results.size()<<" instances, results in "<<output_path<<endl;
+    //The check fails if a flip result is not the one of the first version
+    if (compare && different > 0) {
+        cerr<<"compare-flips: "<<different<<" instances with different flips"<<endl;
+        return 1;
+    }
+    return 0;
+}
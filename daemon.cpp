@@ -0,0 +1,215 @@
+#include "includes/utils/solver.h"
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace boost::json;
+using namespace std;
+using K = CGAL::Exact_predicates_exact_constructions_kernel;
+using Custom_CDT = Custom_Constrained_Delaunay_triangulation_2<K>;
+using std_string = std::string;
+
+//Solver daemon on a Unix domain socket, for many instances without a new process (and Qt) for each one.
+//Every connection is one request: the client writes an instance json (the same as the input of -i) and shuts down
+//its side of the socket, the daemon answers with the solution json (the same as the file of -o) or with {"error": "..."}
+//and closes the connection. The requests wait in a queue of at most -q connections and -j workers solve them
+//(every instance with 1 thread). The "time_limit" of the parameters is the budget of a request, -t is the maximum.
+//A request of more than -m bytes is answered with an error without reading the rest of it.
+//./opt_triangulation_daemon -s /path/to/socket [-j workers] [-q queue] [-t seconds] [-m bytes]
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void request_stop(int) {
+    stop_requested = 1;
+}
+
+//Connections that wait for a worker
+struct Request_queue {
+    mutex queue_mutex;
+    condition_variable ready;
+    deque<int> connections;
+    size_t max_size = 64;
+    bool closed = false;
+};
+
+//Read the whole request (until the client shuts down its side), too_large stops the read after max_size bytes
+static bool read_request(int connection, size_t max_size, std_string& text, bool& too_large) {
+    char buffer[1 << 16];
+    too_large = false;
+    while (true) {
+        ssize_t got = ::read(connection, buffer, sizeof(buffer));
+        if (got == 0) return true;
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (text.size() + got > max_size) {
+            too_large = true;
+            return true;
+        }
+        text.append(buffer, got);
+    }
+}
+
+static void reply_error(int connection, const std_string& message) {
+    Buffered_writer reply(connection);
+    reply<<serialize(object{{"error", message}})<<'\n';
+    reply.close();
+}
+
+//Solve one request and answer on the same connection
+static void serve(int connection, double max_time_limit, size_t max_request_size) {
+    std_string text;
+    bool too_large;
+    if (!read_request(connection, max_request_size, text, too_large)) {
+        cerr<<"Cannot read a request"<<endl;
+        return;
+    }
+    if (too_large) {
+        reply_error(connection, "request is larger than " + to_string(max_request_size) + " bytes");
+        return;
+    }
+    try {
+        Instance instance;
+        std_string error;
+        if (!parse_instance(text, instance, error)) {
+            reply_error(connection, "wrong instance: " + error);
+            return;
+        }
+        if (max_time_limit > 0 && (instance.time_limit <= 0 || instance.time_limit > max_time_limit)) instance.time_limit = max_time_limit;
+        Custom_CDT custom_cdt;
+        Polygon polygon;
+        Solve_result result = solve_instance(instance, custom_cdt, polygon, 1, false);
+        Buffered_writer reply(connection);
+        if (!output(instance.jv, custom_cdt, instance.points, result.obtuse_count, reply) || !reply.close()) {
+            cerr<<"Cannot write a solution"<<endl;
+        }
+    }
+    catch (const exception& e) {
+        reply_error(connection, e.what());
+    }
+}
+
+static void work(Request_queue& queue, double max_time_limit, size_t max_request_size) {
+    while (true) {
+        int connection;
+        {
+            unique_lock<mutex> lock(queue.queue_mutex);
+            queue.ready.wait(lock, [&](){ return queue.closed || !queue.connections.empty(); });
+            if (queue.connections.empty()) return;
+            connection = queue.connections.front();
+            queue.connections.pop_front();
+        }
+        serve(connection, max_time_limit, max_request_size);
+        ::close(connection);
+    }
+}
+
+int main(int argc, char** argv) {
+    std_string socket_path;
+    int num_of_workers = 1;
+    double max_time_limit = 0;
+    size_t max_request_size = 64 << 20;
+    Request_queue queue;
+    for (int i = 1; i < argc; ++i) {
+        if (std_string(argv[i]) == "-s" && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (std_string(argv[i]) == "-j" && i + 1 < argc) {
+            num_of_workers = max(1, atoi(argv[++i]));
+        } else if (std_string(argv[i]) == "-q" && i + 1 < argc) {
+            queue.max_size = max(1, atoi(argv[++i]));
+        } else if (std_string(argv[i]) == "-t" && i + 1 < argc) {
+            max_time_limit = atof(argv[++i]);
+        } else if (std_string(argv[i]) == "-m" && i + 1 < argc) {
+            max_request_size = max(1ll, atoll(argv[++i]));
+        }
+    }
+    sockaddr_un address{};
+    if (socket_path.empty() || socket_path.size() >= sizeof(address.sun_path)) {
+        cerr<<"Empty or too long socket path."<<endl;
+        cout<<"Check this pattern of terminal order: ./opt_triangulation_daemon -s /path/to/socket [-j workers] [-q queue] [-t seconds] [-m bytes]"<<endl;
+        return 1;
+    }
+
+    //A client that goes away must not kill the daemon, SIGINT and SIGTERM stop it after the queued requests
+    signal(SIGPIPE, SIG_IGN);
+    struct sigaction action{};
+    action.sa_handler = request_stop;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    //Non blocking, a connection that is gone between the poll and the accept does not block the main thread
+    int listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    address.sun_family = AF_UNIX;
+    socket_path.copy(address.sun_path, socket_path.size());
+    ::unlink(socket_path.c_str());
+    if (listener < 0 || ::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(listener, 128) != 0) {
+        cerr<<"Cannot listen on "<<socket_path<<": "<<strerror(errno)<<endl;
+        return 1;
+    }
+    cout<<"Listening on "<<socket_path<<" with "<<num_of_workers<<" workers"<<endl;
+
+    //The stop signals are blocked in every thread (the workers get the mask of the main thread) and only the ppoll
+    //of the main thread unblocks them while it waits, so a signal between the check of stop_requested and the wait
+    //is not lost: it stays pending and interrupts the next ppoll
+    sigset_t stop_signals, old_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, &old_signals);
+    vector<thread> workers;
+    for (int i = 0; i < num_of_workers; ++i) workers.emplace_back(work, ref(queue), max_time_limit, max_request_size);
+
+    pollfd listening{listener, POLLIN, 0};
+    while (!stop_requested) {
+        if (::ppoll(&listening, 1, nullptr, &old_signals) < 0) {
+            if (errno == EINTR) continue;
+            cerr<<"poll: "<<strerror(errno)<<endl;
+            break;
+        }
+        //The accepted socket is blocking again (accept does not copy O_NONBLOCK)
+        int connection = ::accept(listener, nullptr, nullptr);
+        if (connection < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNABORTED) continue;
+            cerr<<"accept: "<<strerror(errno)<<endl;
+            break;
+        }
+        //A client that never finishes its request (or never reads the answer) gives its worker back after a minute
+        timeval timeout{60, 0};
+        ::setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        ::setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        bool queued = false;
+        {
+            lock_guard<mutex> lock(queue.queue_mutex);
+            if (queue.connections.size() < queue.max_size) {
+                queue.connections.push_back(connection);
+                queued = true;
+            }
+        }
+        if (queued) queue.ready.notify_one();
+        else {
+            reply_error(connection, "queue is full");
+            ::close(connection);
+        }
+    }
+
+    //Finish the queued requests
+    {
+        lock_guard<mutex> lock(queue.queue_mutex);
+        queue.closed = true;
+    }
+    queue.ready.notify_all();
+    for (auto& worker : workers) worker.join();
+    ::close(listener);
+    ::unlink(socket_path.c_str());
+    return 0;
+}
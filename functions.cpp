@@ -1,5 +1,9 @@
 #include "includes/utils/functions.h"
-#include "includes/utils/extra_graphics.h"
+
+//The threads of the metaheuristics share lazy exact points (see thread_pool.h)
+#ifdef CGAL_HAS_NO_THREADS
+#error "The parallel methods need a CGAL with threads (thread safe lazy exact evaluation)"
+#endif
 
 using namespace boost::json;
 using namespace std;
@@ -17,19 +21,15 @@ using std_string = std::string;
 
 //Is obtuse face
 bool is_obtuse(const Face_handle& face) {
-    Point_2 a = face->vertex(0)->point();
-    Point_2 b = face->vertex(1)->point();
-    Point_2 c = face->vertex(2)->point();
-    return (CGAL::angle(a, b, c) == CGAL::OBTUSE || 
-            CGAL::angle(b, a, c) == CGAL::OBTUSE || 
-            CGAL::angle(a, c, b) == CGAL::OBTUSE);
+    const Point_2& a = face->vertex(0)->point();
+    const Point_2& b = face->vertex(1)->point();
+    const Point_2& c = face->vertex(2)->point();
+    return obtuse_vertex_index(a, b, c) >= 0;
 }
 
 //Is obtuse 3 points (1 face)
 bool is_obtuse2(const Point_2& a, const Point_2& b, const Point_2& c) {
-    return (CGAL::angle(a, b, c) == CGAL::OBTUSE || 
-            CGAL::angle(b, a, c) == CGAL::OBTUSE || 
-            CGAL::angle(a, c, b) == CGAL::OBTUSE);
+    return obtuse_vertex_index(a, b, c) >= 0;
 }
 
 //Read JSON file
@@ -44,14 +44,20 @@ void read_json(const std_string& filename, value& jv) {
 }
 
 //Just count the number of obtuses triangles in a cdt
-int count_obtuse_triangles(CDT& cdt, const Polygon& polygon) {
-    int obtuse_count = 0;
-    for (auto face = cdt.finite_faces_begin(); face != cdt.finite_faces_end(); ++face) {
-        Point_2 p1 = face->vertex(0)->point();
-        Point_2 p2 = face->vertex(1)->point();
-        Point_2 p3 = face->vertex(2)->point();
-        if (is_obtuse(face) && is_face_inside_region(face, polygon)) obtuse_count++;
-    }
+int count_obtuse_triangles(Custom_CDT& cdt, const Polygon& polygon) {
+    Phase_timer timer(PHASE_COUNTING);
+    //The cdt keeps the number of obtuse faces with the region flag
+    int obtuse_count = cdt.number_of_obtuse_faces_in_region();
+    if (obtuse_count == 0 || cdt.dimension() < 2) return obtuse_count;
+    //is_face_inside_region skips the faces with a vertex at (0,0), they are the faces around that vertex
+    Custom_CDT::Locate_type lt;
+    int li;
+    Face_handle located = cdt.locate(Point_2(0, 0), lt, li);
+    if (lt != Custom_CDT::VERTEX) return obtuse_count;
+    Custom_CDT::Face_circulator face = cdt.incident_faces(located->vertex(li)), done(face);
+    do {
+        if (!cdt.is_infinite(face) && cdt.is_obtuse_face(face) && cdt.is_in_region(face)) obtuse_count--;
+    } while (++face != done);
     return obtuse_count;
 }
 
@@ -125,6 +131,8 @@ void insert_projection(Custom_CDT& custom_cdt, const Face_handle& face, Polygon&
     Point_2 opposite1, opposite2;
 
     Point_2 obtuse_angle_vertex = find_obtuse_vertex(p1, p2, p3);
+    //The projection is inside of the edge opposite to the obtuse vertex
+    int obtuse_index = obtuse_vertex_index(p1, p2, p3);
     //Find the obtuse point, and the 2 opposites
     if (obtuse_angle_vertex == p1) {
         opposite1 = p2;
@@ -142,7 +150,10 @@ void insert_projection(Custom_CDT& custom_cdt, const Face_handle& face, Polygon&
     
     //Take the projection Steiner point
     Line_2 line(opposite1, opposite2);
-    Point_2 projected_point = line.projection(obtuse_angle_vertex);
+    Point_2 projection = line.projection(obtuse_angle_vertex);
+    //Snapped to the grid, or along the opposite edge if it is constrained (so it stays inside of the edge)
+    bool off_edge = snaps_off_edge(custom_cdt, face, obtuse_index);
+    Point_2 projected_point = off_edge ? snap_point(projection, custom_cdt.snap_denominator()) : snap_on_segment(opposite1, opposite2, projection, custom_cdt.snap_denominator());
     //"Return" and the projected_point
     in_projection = projected_point;
     //And the opposide edge of the projected_point
@@ -151,8 +162,8 @@ void insert_projection(Custom_CDT& custom_cdt, const Face_handle& face, Polygon&
     int obtuses_before = count_obtuse_triangles(custom_cdt, polygon);
 
     if(insert_projection){
-        custom_cdt.insert_no_flip(projected_point);
-        start_the_flips(custom_cdt, polygon);
+        Vertex_handle steiner = off_edge ? custom_cdt.insert_no_flip(projected_point, face) : custom_cdt.insert_no_flip(projected_point, Custom_CDT::EDGE, face, obtuse_index);
+        start_the_flips(custom_cdt, polygon, steiner);
     }
     
 }
@@ -162,12 +173,17 @@ void insert_projection(Custom_CDT& custom_cdt, const Face_handle& face, Polygon&
 void insert_midpoint(Custom_CDT& custom_cdt, const Face_handle& face, Polygon& polygon, Point_2& in_midpoint, Segment_2& longest_edge) {
     if (!is_face_inside_region(face, polygon)) return;
     longest_edge = find_longest_edge(face);
-    Point_2 midpoint = CGAL::midpoint(longest_edge.source(), longest_edge.target());
+    int edge_index = opposite_vertex_index(face, longest_edge);
+    //Snapped to the grid, or exact if the longest edge is constrained
+    bool off_edge = snaps_off_edge(custom_cdt, face, edge_index);
+    Point_2 exact_midpoint = CGAL::midpoint(longest_edge.source(), longest_edge.target());
+    Point_2 midpoint = off_edge ? snap_point(exact_midpoint, custom_cdt.snap_denominator()) : flatten_point(exact_midpoint, custom_cdt.snap_denominator());
     in_midpoint = midpoint;
 
     if (is_point_inside_region(midpoint, polygon)) {
-        custom_cdt.insert_no_flip(midpoint);
-        start_the_flips(custom_cdt, polygon);
+        //The exact midpoint is inside of the longest edge of the face
+        Vertex_handle steiner = off_edge ? custom_cdt.insert_no_flip(midpoint, face) : custom_cdt.insert_no_flip(midpoint, Custom_CDT::EDGE, face, edge_index);
+        start_the_flips(custom_cdt, polygon, steiner);
     }  
 }
 
@@ -199,13 +215,9 @@ bool insert_adjacent_steiner(Custom_CDT& custom_cdt, const Face_handle& face1, c
         for (int i = 0; i < 3; ++i) {
             Face_handle neighbor = curent_face->neighbor(i);
 
-            //Get one edge of the curent_face
-            Point_2 p1 = curent_face->vertex((i + 1) % 3)->point();
-            Point_2 p2 = curent_face->vertex((i + 2) % 3)->point();
-
             //Skip already visited faces or unsuitable neighbors
             if (visited_faces.count(neighbor) > 0 || custom_cdt.is_infinite(neighbor) || 
-                !is_obtuse(neighbor) || custom_cdt.is_constrained(make_pair(curent_face, i)) || is_edge_on_boundary(p1, p2, polygon)) {
+                !is_obtuse(neighbor) || custom_cdt.is_constrained(make_pair(curent_face, i)) || is_edge_on_boundary(curent_face, i)) {
                 continue;
             }
 
@@ -226,18 +238,20 @@ bool insert_adjacent_steiner(Custom_CDT& custom_cdt, const Face_handle& face1, c
     //Compute the midpoint of all collected vertices
     if (!unique_points.empty()) {
         vector<Point_2> points(unique_points.begin(), unique_points.end());
-        adjacent_steiner = compute_centroid(points);
+        adjacent_steiner = snap_point(compute_centroid(points), custom_cdt.snap_denominator());
     } else {
         //Default to the centroid of the original face if no neighbors are found
         Point_2 v0 = face1->vertex(0)->point();
         Point_2 v1 = face1->vertex(1)->point();
         Point_2 v2 = face1->vertex(2)->point();
-        adjacent_steiner = CGAL::centroid(v0, v1, v2);
+        adjacent_steiner = snap_point(CGAL::centroid(v0, v1, v2), custom_cdt.snap_denominator());
     }
+    //A snapped centroid can be out of the region
+    if (!is_point_inside_region(adjacent_steiner, polygon)) return false;
     //Check if the polygon is convex
     if(is_polygon_convex(unique_points)){
-        custom_cdt.insert_no_flip(adjacent_steiner);
-        start_the_flips(custom_cdt, polygon);
+        Vertex_handle steiner = custom_cdt.insert_no_flip(adjacent_steiner, face1);
+        start_the_flips(custom_cdt, polygon, steiner);
         return true;
     }
     else return false;
@@ -253,7 +267,7 @@ void insert_adjacent_steiner_local_search(Custom_CDT& custom_cdt, const Face_han
     Point_2 v0 = face1->vertex(0)->point();
     Point_2 v1 = face1->vertex(1)->point();
     Point_2 v2 = face1->vertex(2)->point();
-    Point_2 best_steiner_point = CGAL::centroid(v0, v1, v2);
+    Point_2 best_steiner_point = snap_point(CGAL::centroid(v0, v1, v2), custom_cdt.snap_denominator());
     adjacent_steiner = best_steiner_point;
     //Use a queue to perform BFS-like traversal
     queue<Face_handle> face_queue;
@@ -292,22 +306,26 @@ void insert_adjacent_steiner_local_search(Custom_CDT& custom_cdt, const Face_han
             }
             //Compute the centroid of all collected points as a Steiner candidate
             vector<Point_2> polygon_points(unique_points.begin(), unique_points.end());
-            Point_2 curent_steiner_point = compute_centroid(polygon_points);
-
-            //Simulate inserting this Steiner point in a temporary CDT
-            Custom_CDT simulate_cdt = custom_cdt;
-            simulate_cdt.insert_no_flip(curent_steiner_point);
-            start_the_flips(simulate_cdt, polygon);
-            unsigned int simulated_obtuse_count = count_obtuse_triangles(simulate_cdt, polygon);
-        
-            //Change the best_steiner_point and update the best_obtuse_count if worth it
-            if((simulated_obtuse_count < best_obtuse_count) && is_polygon_convex(unique_points)){
-                //Update best_obtuse_count, best_steiner_point, adjacent_steiner
-                best_obtuse_count = simulated_obtuse_count;
-                best_steiner_point = curent_steiner_point;
-                adjacent_steiner = best_steiner_point;
-                custom_cdt.insert_no_flip(best_steiner_point);
-                start_the_flips(custom_cdt, polygon);
+            Point_2 curent_steiner_point = snap_point(compute_centroid(polygon_points), custom_cdt.snap_denominator());
+
+            //A snapped centroid can be out of the region, then this candidate is skipped
+            if (is_point_inside_region(curent_steiner_point, polygon)) {
+                //Simulate inserting this Steiner point and take it back
+                custom_cdt.begin_transaction();
+                Vertex_handle steiner = custom_cdt.insert_no_flip(curent_steiner_point, curent_face);
+                start_the_flips(custom_cdt, polygon, steiner);
+                unsigned int simulated_obtuse_count = count_obtuse_triangles(custom_cdt, polygon);
+                custom_cdt.rollback_transaction();
+            
+                //Change the best_steiner_point and update the best_obtuse_count if worth it
+                if((simulated_obtuse_count < best_obtuse_count) && is_polygon_convex(unique_points)){
+                    //Update best_obtuse_count, best_steiner_point, adjacent_steiner
+                    best_obtuse_count = simulated_obtuse_count;
+                    best_steiner_point = curent_steiner_point;
+                    adjacent_steiner = best_steiner_point;
+                    Vertex_handle steiner = custom_cdt.insert_no_flip(best_steiner_point, curent_face);
+                    start_the_flips(custom_cdt, polygon, steiner);
+                }
             }
             //Mark the neighbor as visited and add it to the queue
             visited_faces.insert(neighbor);
@@ -316,8 +334,8 @@ void insert_adjacent_steiner_local_search(Custom_CDT& custom_cdt, const Face_han
     }
 }
 
-//The local Search method
-void local_search(Custom_CDT& custom_cdt, Polygon& polygon, int& L){
+//The local Search method. custom_cdt keeps only the improvements, so when the deadline expires it is the best so far
+void local_search(Custom_CDT& custom_cdt, Polygon& polygon, int& L, const Deadline& deadline){
     unsigned int num_of_obtuses = 0;
     bool progress = true;
     int dont_use_circumcenter = false;
@@ -325,39 +343,40 @@ void local_search(Custom_CDT& custom_cdt, Polygon& polygon, int& L){
         while(progress){
             progress = false;
             for (auto face = custom_cdt.finite_faces_begin(); face != custom_cdt.finite_faces_end(); ++face) {
-                if (!is_obtuse(face)) continue;
+                if (!custom_cdt.is_obtuse_face(face)) continue;
                 if (!is_face_inside_region(face, polygon)) continue;
+                if (deadline.expired()) {
+                    cout<<"Local Search: out of time"<<endl;
+                    L = 0;
+                    return;
+                }
                 
                 num_of_obtuses = count_obtuse_triangles(custom_cdt, polygon);
                 if (num_of_obtuses == 0) {
                     progress = false;
                     break;
                 }
-                //Create temporary CDT copies for each method
-                Custom_CDT cdt_circum = custom_cdt;
-                Custom_CDT cdt_midpoint = custom_cdt;
-                Custom_CDT cdt_projection = custom_cdt;
-                Custom_CDT cdt_adjacent = custom_cdt;
-                Custom_CDT cdt_centroid = custom_cdt;
-                vector<Custom_CDT> cdt_variants = {cdt_circum, cdt_midpoint, cdt_projection, cdt_adjacent, cdt_centroid};
                 vector<Point_2> steiner_points(5);
                 //Midpoint edge: We need this edge to check if the steiner was entered on the boundary
                 Segment_2 longest_edge;
                 //Projection edge: We need this edge to check if the steiner was entered on the boundary
                 Segment_2 opposide_edge;
                 dont_use_circumcenter = false;
-                //Apply Steiner point insertion methods
-                if(!insert_circumcenter(cdt_variants[0], face, polygon, steiner_points[0])) dont_use_circumcenter = true;
-                insert_midpoint(cdt_variants[1], face, polygon, steiner_points[1], longest_edge);
-                insert_projection(cdt_variants[2], face, polygon, steiner_points[2], opposide_edge);
-                insert_adjacent_steiner_local_search(cdt_variants[3], face, polygon, steiner_points[3]);
-                insert_centroid(cdt_variants[4], face, polygon, steiner_points[4]);
-
                 //Vector to store obtuse counts
                 vector<unsigned int> obtuses_after(5);
 
-                for (int i = 0; i < cdt_variants.size(); ++i) {
-                    obtuses_after[i] = count_obtuse_triangles(cdt_variants[i], polygon);
+                //Apply every Steiner point insertion method on the custom_cdt, count the obtuses and take it back
+                for (int i = 0; i < 5; ++i) {
+                    custom_cdt.begin_transaction();
+                    switch(i){
+                        case 0: if(!insert_circumcenter(custom_cdt, face, polygon, steiner_points[0])) dont_use_circumcenter = true; break;
+                        case 1: insert_midpoint(custom_cdt, face, polygon, steiner_points[1], longest_edge); break;
+                        case 2: insert_projection(custom_cdt, face, polygon, steiner_points[2], opposide_edge); break;
+                        case 3: insert_adjacent_steiner_local_search(custom_cdt, face, polygon, steiner_points[3]); break;
+                        case 4: insert_centroid(custom_cdt, face, polygon, steiner_points[4]); break;
+                    }
+                    obtuses_after[i] = count_obtuse_triangles(custom_cdt, polygon);
+                    custom_cdt.rollback_transaction();
                 }
                 //Find the method with the minimum obtuse triangles
                 auto min_iter = std::min_element(obtuses_after.begin(), obtuses_after.end());
@@ -366,8 +385,8 @@ void local_search(Custom_CDT& custom_cdt, Polygon& polygon, int& L){
                 //Apply the best method
                 if (obtuses_after[min_index] < num_of_obtuses) {
                     if(dont_use_circumcenter && min_index == 0) cerr<<"You choose the circumcenter but it was outside of the boundary"<<endl;
-                    custom_cdt.insert_no_flip(steiner_points[min_index]);
-                    start_the_flips(custom_cdt, polygon);
+                    Vertex_handle steiner = custom_cdt.insert_no_flip(steiner_points[min_index], face);
+                    start_the_flips(custom_cdt, polygon, steiner);
                     progress = true;
                     //For projection or midpoint check if the steiner inserted in the boundary of polygon and update the polygon
                     if(min_index == 1) update_polygon(polygon, steiner_points[min_index], longest_edge.source(), longest_edge.target());
@@ -385,12 +404,12 @@ double calculate_energy(const int obtuse_faces, const int steiner_points, const
     return alpha * obtuse_faces + beta * steiner_points;
 }
 
-bool should_accept_bad_steiner(const double deltaE,const double T) {
+bool should_accept_bad_steiner(const double deltaE,const double T, std::mt19937& rng) {
     //Compute e^(-∆E / T)
     double probability = exp(-deltaE / T);
     
-    //Generate R uniformly in [0, 1]
-    double R = static_cast<double>(rand()) / RAND_MAX;
+    //Generate R uniformly in [0, 1] (from the RNG of the chain, so parallel chains don't share state)
+    double R = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
 
     //Accept transition if e^(-∆E / T) ≥ R
     return probability >= R;
@@ -398,83 +417,106 @@ bool should_accept_bad_steiner(const double deltaE,const double T) {
 
 //Simualated annealing method
 void simulated_annealing(Custom_CDT& custom_cdt, Polygon& polygon, int max_iterations, const double& alpha, const double& beta, const int& batch_size){
+    std::mt19937 rng(std::random_device{}()); //Initialize RNG
+    simulated_annealing(custom_cdt, polygon, max_iterations, alpha, beta, batch_size, rng, true);
+}
+
+//One chain of simulated annealing with its own RNG, verbose prints the progress of every iteration.
+//When the deadline expires the chain stops and returns its best triangulation
+void simulated_annealing(Custom_CDT& custom_cdt, Polygon& polygon, int max_iterations, const double& alpha, const double& beta, const int& batch_size, std::mt19937& rng, bool verbose, const Deadline& deadline){
     int obtuse_faces = count_obtuse_triangles(custom_cdt, polygon);
     int init_vertices = count_vertices(custom_cdt);
     double T = 1.0, delta_E = 0, E_new = 0, cooling_rate = 0.99, min_temp = 1e-6;
     double best_E = calculate_energy(obtuse_faces, 0, alpha, beta);
     int num_of_transition = 0, random_steiner = 0;
     
-    Custom_CDT simulate_cdt = custom_cdt, best_cdt = custom_cdt;
+    //The Steiner insertions are simulated on custom_cdt inside a transaction (commit or rollback).
+    //The best triangulation is a snapshot of custom_cdt, saving and restoring it costs only the changes since the snapshot
+    custom_cdt.begin_snapshot();
     Point_2 steiner_point;
     //These edges are Midpoint and opposite Projection edges, we need these edges to check, if these steiners was entered on the boundary
     Segment_2 longest_edge, opposite_edge;
     int best_num_steiner = 0, best_obtuse_faces = obtuse_faces, counter_steiner = 0;
     int start = obtuse_faces, end = obtuse_faces;
-    bool progress = true, obtuse_neighbors = false, is_polygon_convex = false;
-    std::mt19937 rng(std::random_device{}()); //Initialize RNG
+    bool progress = true, obtuse_neighbors = false, is_polygon_convex = false, out_of_time = false;
     std::uniform_int_distribution<int> dist(0, 4); //Define distribution
     //As we have progress continue
-    while(progress){
+    while(progress && !out_of_time){
         progress = false;
-        start = count_obtuse_triangles(best_cdt, polygon);
+        //Here custom_cdt is the best triangulation
+        start = count_obtuse_triangles(custom_cdt, polygon);
         if(start == 0) break;
         T = 1.0;
         num_of_transition = 0;
-        start_the_flips(best_cdt, polygon);
-        custom_cdt = best_cdt;
-        simulate_cdt = best_cdt;
+        start_the_flips(custom_cdt, polygon);
+        custom_cdt.save_snapshot();
 
         for (int i = 0; i < max_iterations && T > min_temp; ++i) {
             if (obtuse_faces == 0) break;
-            //After from brake, or finite_faces_end(), keep the simulate_cdt as custom_cdt (curent)
-            custom_cdt = simulate_cdt;
+            if (deadline.expired()) {
+                out_of_time = true;
+                break;
+            }
             for (auto face = custom_cdt.finite_faces_begin(); face != custom_cdt.finite_faces_end(); ++face){
-                if (!is_obtuse(face)) continue;
+                if (!custom_cdt.is_obtuse_face(face)) continue;
                 if (!is_face_inside_region(face, polygon)) continue;
+                if (deadline.expired()) {
+                    out_of_time = true;
+                    break;
+                }
                 random_steiner = dist(rng);
+                //The rollback gives back the same faces, so the iterator stays valid
+                custom_cdt.begin_transaction();
                 
                 switch(random_steiner){
                     //If circumcenter steiner is outside of the boundary, continue
                     case 0: 
-                        if(!insert_circumcenter(simulate_cdt, face, polygon, steiner_point)){
+                        if(!insert_circumcenter(custom_cdt, face, polygon, steiner_point)){
+                            custom_cdt.rollback_transaction();
                             --face;
-                            //simulate_cdt = custom_cdt; 
                             continue;
                         }
                         break;
-                    case 1: insert_midpoint(simulate_cdt, face, polygon, steiner_point, longest_edge); break;
-                    case 2: insert_projection(simulate_cdt, face, polygon, steiner_point, opposite_edge); break;
+                    case 1: insert_midpoint(custom_cdt, face, polygon, steiner_point, longest_edge); break;
+                    case 2: insert_projection(custom_cdt, face, polygon, steiner_point, opposite_edge); break;
                     case 3:
                         //If the polygon of the adjacent steiner is not convex or if the face has no obtuse neighbors, skip the face
-                        is_polygon_convex = insert_adjacent_steiner(simulate_cdt, face, polygon, steiner_point);
+                        is_polygon_convex = insert_adjacent_steiner(custom_cdt, face, polygon, steiner_point);
                         if((!is_polygon_convex)){
-                            //simulate_cdt = custom_cdt;
-                            insert_projection(simulate_cdt, face, polygon, steiner_point, opposite_edge);
+                            //The face can be changed by the projection, so the centroid is taken before
+                            Point_2 centroid = snap_point(CGAL::centroid(face->vertex(0)->point(), face->vertex(1)->point(), face->vertex(2)->point()), custom_cdt.snap_denominator());
+                            insert_projection(custom_cdt, face, polygon, steiner_point, opposite_edge);
                             random_steiner = 2;
+                            steiner_point = centroid;
+                            //A snapped centroid can be out of the region
+                            if (is_point_inside_region(centroid, polygon)) {
+                                Vertex_handle steiner = custom_cdt.insert_no_flip(centroid, face);
+                                start_the_flips(custom_cdt, polygon, steiner);
+                            }
                         }
-                        else break;
-                    case 4: insert_centroid(simulate_cdt, face, polygon, steiner_point); break;
+                        break;
+                    case 4: insert_centroid(custom_cdt, face, polygon, steiner_point); break;
                     default: break;
                 }
 
-                obtuse_faces = count_obtuse_triangles(simulate_cdt, polygon);
-                counter_steiner = count_vertices(simulate_cdt) - init_vertices;
+                obtuse_faces = count_obtuse_triangles(custom_cdt, polygon);
+                counter_steiner = count_vertices(custom_cdt) - init_vertices;
                 E_new = calculate_energy(obtuse_faces, counter_steiner, alpha, beta);
                 
                 delta_E = E_new - best_E;
                 //For any undetectable program error
                 if (delta_E == 0) {
-                    simulate_cdt = custom_cdt;
+                    custom_cdt.rollback_transaction();
                     continue;
                 }
                 //Trick to insert into should_accept_bad_steiner(delta_E,T) to reintroduce triangulation as best_cdt because we have increase the obtuses by 3
                 if (delta_E >= (3*alpha)) delta_E = 0.000001;
                 
                 if(delta_E < 0){
-                    //Update the iterator
-                    custom_cdt = simulate_cdt;
+                    //Keep the steiner in the curent triangulation
+                    custom_cdt.commit_transaction();
                     //Update the best value
-                    best_cdt = simulate_cdt;
+                    custom_cdt.save_snapshot();
                     best_E = E_new;
                     //Optional for prints
                     best_obtuse_faces = obtuse_faces;
@@ -486,14 +528,13 @@ void simulated_annealing(Custom_CDT& custom_cdt, Polygon& polygon, int max_itera
                     if(random_steiner == 2) update_polygon(polygon, steiner_point, opposite_edge.source(), opposite_edge.target());
                     break;
                 }
-                else if(should_accept_bad_steiner(delta_E,T)){
+                else if(should_accept_bad_steiner(delta_E,T,rng)){
                     num_of_transition++;
-                    //Run the for loop with the simulated_cdt
-                    custom_cdt = simulate_cdt;
-                    //If we havn't improve after from 5 steiner insertion or if we have increase the obtuses by 3, reset the simulated_cdt
+                    //Run the for loop with the accepted steiner
+                    custom_cdt.commit_transaction();
+                    //If we havn't improve after from 5 steiner insertion or if we have increase the obtuses by 3, reset the curent triangulation
                     if(num_of_transition >= batch_size || delta_E >= (3*alpha) || delta_E == 0.000001){
-                        simulate_cdt = best_cdt; // Reset to the best triangulation
-                        custom_cdt = best_cdt;
+                        custom_cdt.restore_snapshot(); // Reset to the best triangulation
                         num_of_transition = 0;
                     }
                     break;
@@ -504,23 +545,67 @@ void simulated_annealing(Custom_CDT& custom_cdt, Polygon& polygon, int max_itera
                 if (T < 1.0 && ((i > 680 && i < 690) || (i > 830 && i < 840))) T = T*1.4;
                 if (T < 1.0 && ((i > 940 && i < 950) || (i > 1050 && i < 1060))) T = T*1.4;
                 if (T < 1.0 && ((i > 1160 && i < 1170) || (i > 1280 && i < 1290))) T = T*1.4;
+                //Case that we didn't accept this steiner. So, take back the previous triangulation
+                custom_cdt.rollback_transaction();
                 if(obtuse_faces == 1) face--;
-                //Case that we didn't insert this steiner into simulate_cdt. So, take back the previous simulate_cdt (custom_cdt)
-                simulate_cdt = custom_cdt;
             }
             //Update temperature (decrease)
             T = T*(cooling_rate);
-            cout<<"Iteration: " <<i<< ", T: "<<T<<", best_obtuse_faces: "<<best_obtuse_faces<<" random_steiner: "<<random_steiner<<", DeltaE: "<<delta_E<<" best_E: "<<best_E<<", Steiner points: "<<best_num_steiner<<endl; 
+            if(verbose) cout<<"Iteration: " <<i<< ", T: "<<T<<", best_obtuse_faces: "<<best_obtuse_faces<<" random_steiner: "<<random_steiner<<", DeltaE: "<<delta_E<<" best_E: "<<best_E<<", Steiner points: "<<best_num_steiner<<endl; 
         }
-        end = count_obtuse_triangles(best_cdt, polygon);
+        custom_cdt.restore_snapshot();
+        end = count_obtuse_triangles(custom_cdt, polygon);
         if(end < start && end > 0) progress = true;
     }
+    if(out_of_time && verbose) cout<<"Simulated Annealing: out of time"<<endl;
     //"Return" the best cdt
-    custom_cdt = best_cdt;
+    custom_cdt.end_snapshot();
+}
+
+//Run num_of_chains independent simulated annealing chains in parallel, each on its own copy of the cdt
+//and of the polygon and with its own stream of rng_context, and keep the chain with the lowest energy
+void parallel_simulated_annealing(Custom_CDT& custom_cdt, Polygon& polygon, int max_iterations, const double& alpha, const double& beta, const int& batch_size, int num_of_chains, const Rng_context& rng_context, const Deadline& deadline){
+    int init_vertices = count_vertices(custom_cdt);
+    vector<Custom_CDT> chain_cdts(num_of_chains, custom_cdt);
+    vector<Polygon> chain_polygons(num_of_chains, polygon);
+    vector<double> chain_energies(num_of_chains);
+    vector<thread> chains;
+
+    for (int chain = 0; chain < num_of_chains; ++chain) {
+        chains.emplace_back([&, chain](){
+            std::mt19937 rng = rng_context.split(chain + 1);
+            //Only the first chain prints its iterations
+            simulated_annealing(chain_cdts[chain], chain_polygons[chain], max_iterations, alpha, beta, batch_size, rng, chain == 0, deadline);
+            int obtuse_faces = count_obtuse_triangles(chain_cdts[chain], chain_polygons[chain]);
+            int steiner_points = count_vertices(chain_cdts[chain]) - init_vertices;
+            chain_energies[chain] = calculate_energy(obtuse_faces, steiner_points, alpha, beta);
+        });
+    }
+    for (auto& chain : chains) chain.join();
+
+    int best_chain = min_element(chain_energies.begin(), chain_energies.end()) - chain_energies.begin();
+    for (int chain = 0; chain < num_of_chains; ++chain) {
+        cout<<"Chain "<<chain<<": E = "<<chain_energies[chain]<<(chain == best_chain ? " (best)" : "")<<endl;
+    }
+    //"Return" the best cdt and its polygon
+    custom_cdt = chain_cdts[best_chain];
+    polygon = chain_polygons[best_chain];
 }
 
 //Ant colony method
 void ant_colony(Custom_CDT& custom_cdt, Polygon& polygon, const double& alpha, const double& beta, const double& chi, const double& psi, const double& lamda, const int& L, const int& kappa){
+    ant_colony(custom_cdt, polygon, alpha, beta, chi, psi, lamda, L, kappa, 1);
+}
+
+//Ant colony with the ants of every cycle on num_of_threads threads
+void ant_colony(Custom_CDT& custom_cdt, Polygon& polygon, const double& alpha, const double& beta, const double& chi, const double& psi, const double& lamda, const int& L, const int& kappa, int num_of_threads){
+    Rng_context rng_context(Rng_context::random_seed());
+    ant_colony(custom_cdt, polygon, alpha, beta, chi, psi, lamda, L, kappa, num_of_threads, rng_context);
+}
+
+//Every ant of every cycle draws from its own stream of rng_context, so the run is the same for the same seed with any num_of_threads.
+//When the deadline expires no more cycles start and custom_cdt gets the best triangulation
+void ant_colony(Custom_CDT& custom_cdt, Polygon& polygon, const double& alpha, const double& beta, const double& chi, const double& psi, const double& lamda, const int& L, const int& kappa, int num_of_threads, const Rng_context& rng_context, const Deadline& deadline){
     int init_vertices = count_vertices(custom_cdt);
     int obtuse_faces = count_obtuse_triangles(custom_cdt, polygon);
     int new_obtuse_faces = obtuse_faces; 
@@ -529,8 +614,6 @@ void ant_colony(Custom_CDT& custom_cdt, Polygon& polygon, const double& alpha, c
     int best_num_steiner = 0, best_obtuse_faces = obtuse_faces, counter_steiner = 0;
     int count_ants = kappa;
     cout<<"Num of ants: "<<count_ants<<endl;
-    bool obtuse_neighbors = false, can_we_use_adjacent = false;
-    double ro = 0.0;
       
     //Midpoint edge: We need this edge to check if the steiner was entered on the boundary
     Segment_2 longest_edge;
@@ -544,7 +627,7 @@ void ant_colony(Custom_CDT& custom_cdt, Polygon& polygon, const double& alpha, c
     vector<Ant> ant_reduce_obtuses_vector;
 
     Ant best_cycle_ant;
-    Ant::initialize_Ants(ants, custom_cdt);
+    Ant::initialize_Ants(ants);
 
     //Initialize pheromones    
     vector<double> taf(NUM_METHODS);
@@ -558,95 +641,122 @@ void ant_colony(Custom_CDT& custom_cdt, Polygon& polygon, const double& alpha, c
     }
 
     Point_2 curent_steiner_point;
-    Custom_CDT curent_cdt = custom_cdt;
-    Custom_CDT best_cdt = custom_cdt;
+    //The winners are inserted straight into custom_cdt, it is the best triangulation of the colony
+    Custom_CDT& best_cdt = custom_cdt;
     SteinerMethod curent_method;
 
+    //Workers for the ants
+    Thread_pool pool(num_of_threads);
+    //The ants simulate their moves on a replica of best_cdt of their worker (one copy per worker, not per ant).
+    //With one worker the moves are simulated on best_cdt itself
+    vector<Custom_CDT> replicas(pool.size() > 1 ? pool.size() : 0, best_cdt);
+
     /////////////////////////////////////////////////////
     for (int cycle = 0; cycle < L; ++cycle) {
         if (new_obtuse_faces == 0) break;
-        //Take as curent cdt the best cdt (restart)
-        //curent_cdt = best_cdt;
+        if (deadline.expired()) {
+            cout<<"Ant Colony: out of time"<<endl;
+            break;
+        }
         //Clean vectors
         ant_reduce_obtuses_vector.clear();
         ant_last_winners_vector.clear();
       
-        //Ants
-        for (int ant_index = 0; ant_index < count_ants; ++ant_index) {
-            ants[ant_index].set_Custom_CDT(curent_cdt);
+        //Ants: every ant simulates its move inside a transaction on the replica of its worker and takes it back,
+        //so the ants of a cycle run in parallel and all of them start from best_cdt
+        pool.parallel_for(count_ants, [&](int ant_index, int worker){
+            //Out of time: the remaining ants of the cycle do nothing (the ants that finished are still used)
+            if (deadline.expired()) return;
+            Ant& ant = ants[ant_index];
+            Custom_CDT& ant_cdt = replicas.empty() ? best_cdt : replicas[worker];
+            std::mt19937 rng = rng_context.split(static_cast<std::uint64_t>(cycle) * count_ants + ant_index + 1);
+            //The heuristic values are written by selectSteinerMethod, so each ant has its own
+            vector<double> ant_hta = hta;
+            Point_2 ant_steiner_point;
+            Segment_2 ant_longest_edge, ant_opposite_edge;
 
             //Chose obtuse face and check it
-            Face_handle face = give_random_obtuse(ants[ant_index].get_Custom_CDT(), polygon);
-            if (!is_obtuse(face)) continue;
-            if (!is_face_inside_region(face, polygon)) continue;
+            Face_handle face = give_random_obtuse(ant_cdt, polygon, rng);
+            if (face == Face_handle()) return;
+            if (!is_obtuse(face)) return;
+            if (!is_face_inside_region(face, polygon)) return;
+
+            ant_cdt.begin_transaction();
+            //Record the changed region while the ant works: the faces of best_cdt that the insertion and the flips destroy.
+            //A face that the ant created and then destroyed again (by a later flip) is only removed from created_faces
+            Face_key_set destroyed_faces, created_faces;
+            ant_cdt.set_face_observers(
+                [&](Face_handle f){
+                    if (ant_cdt.is_infinite(f)) return;
+                    Face_key key = face_key(f);
+                    if (created_faces.erase(key) == 0) destroyed_faces.insert(key);
+                },
+                [&](Face_handle f){
+                    if (ant_cdt.is_infinite(f)) return;
+                    created_faces.insert(face_key(f));
+                });
 
             /*Improve triangulation*/
-            ro = calculate_radius_to_height(face, curent_cdt);
-            obtuse_neighbors = has_obtuse_neighbors(curent_cdt, face, polygon);
-            curent_method = selectSteinerMethod(ro, taf, hta, chi, psi, obtuse_neighbors);
+            double ant_ro = calculate_radius_to_height(face, ant_cdt);
+            bool ant_obtuse_neighbors = has_obtuse_neighbors(ant_cdt, face, polygon);
+            SteinerMethod ant_method = selectSteinerMethod(ant_ro, taf, ant_hta, chi, psi, ant_obtuse_neighbors, rng);
             
-            switch(curent_method){
+            switch(ant_method){
                 //If circumcenter steiner is outside of the boundary or the opposite edge of obtuse vertex is constraint, use the centroid
                 case 0: 
-                    if(!insert_circumcenter(curent_cdt, face, polygon, curent_steiner_point)){
-                        //curent_cdt = best_cdt;
-                        insert_centroid(curent_cdt, face, polygon, curent_steiner_point); 
-                        curent_method = CENTROID;
+                    if(!insert_circumcenter(ant_cdt, face, polygon, ant_steiner_point)){
+                        insert_centroid(ant_cdt, face, polygon, ant_steiner_point); 
+                        ant_method = CENTROID;
                         break;
                     }
                     else break;
-                case 1: insert_midpoint(curent_cdt, face, polygon, curent_steiner_point, longest_edge); break;
-                case 2: insert_projection(curent_cdt, face, polygon, curent_steiner_point, opposite_edge); break;
+                case 1: insert_midpoint(ant_cdt, face, polygon, ant_steiner_point, ant_longest_edge); break;
+                case 2: insert_projection(ant_cdt, face, polygon, ant_steiner_point, ant_opposite_edge); break;
                 case 3:
                     //If the face has obtuse neighbor(s) and the polygon of adjacent points is convex, then insert the adjacent steiner
-                    can_we_use_adjacent = insert_adjacent_steiner(curent_cdt, face, polygon, curent_steiner_point);
-                    if((!can_we_use_adjacent)){
-                        //curent_cdt = best_cdt;
-                        insert_projection(curent_cdt, face, polygon, curent_steiner_point, opposite_edge);
-                        curent_method = PROJECTION;
+                    if(!insert_adjacent_steiner(ant_cdt, face, polygon, ant_steiner_point)){
+                        insert_projection(ant_cdt, face, polygon, ant_steiner_point, ant_opposite_edge);
+                        ant_method = PROJECTION;
                     } 
-                    else break;
+                    break;
                 default: break;
             }
+            ant_cdt.clear_face_observers();
+            ant.set_affected_faces(std::move(destroyed_faces));
             
             //Save the No of method into Ant
-            ants[ant_index].set_steiner_method(curent_method);
-            //Save the curent cdt into Ant
-            ants[ant_index].set_Custom_CDT(curent_cdt);
+            ant.set_steiner_method(ant_method);
             //Save the steiner into Ant   
-            ants[ant_index].set_steiner(curent_steiner_point);
+            ant.set_steiner(ant_steiner_point);
             
-            ants[ant_index].set_num_of_obtuses(count_obtuse_triangles(ants[ant_index].get_Custom_CDT(), polygon));
-            new_obtuse_faces = ants[ant_index].get_num_of_obtuses();
-            counter_steiner = count_vertices(ants[ant_index].get_Custom_CDT()) - init_vertices;
+            ant.set_num_of_obtuses(count_obtuse_triangles(ant_cdt, polygon));
+            int ant_steiners = count_vertices(ant_cdt) - init_vertices;
+            //The replica is best_cdt again for the next ant of the worker
+            ant_cdt.rollback_transaction();
             //Save the energy into Ant
-            ants[ant_index].set_energy( calculate_energy(new_obtuse_faces, counter_steiner, alpha, beta) );
+            ant.set_energy( calculate_energy(ant.get_num_of_obtuses(), ant_steiners, alpha, beta) );
             //Save the DeltaE into Ant
-            ants[ant_index].set_DeltaE( (ants[ant_index].get_energy() - best_E) );
+            ant.set_DeltaE( (ant.get_energy() - best_E) );
             
             /*Evaluate the resulting triangulation*/
             //Update if this steiner improve the triangulation
-            if (ants[ant_index].get_DeltaE() < 0) {
-                ants[ant_index].set_reduce_obtuses(true);
+            if (ant.get_DeltaE() < 0) {
+                ant.set_reduce_obtuses(true);
                 //Save and the longest_edge, opposite_edge because we need it to update the polygon, if the steiner is on boundary
-                if((ants[ant_index].get_steiner_method() == 1) && polygon.bounded_side(ants[ant_index].get_steiner_point()) == CGAL::ON_BOUNDARY) 
-                    ants[ant_index].set_longest_edge_midpoint(longest_edge);
-                if((ants[ant_index].get_steiner_method() == 2) && polygon.bounded_side(ants[ant_index].get_steiner_point()) == CGAL::ON_BOUNDARY) 
-                    ants[ant_index].set_opposite_edge_projection(opposite_edge);
+                if((ant.get_steiner_method() == 1) && polygon.bounded_side(ant.get_steiner_point()) == CGAL::ON_BOUNDARY) 
+                    ant.set_longest_edge_midpoint(ant_longest_edge);
+                if((ant.get_steiner_method() == 2) && polygon.bounded_side(ant.get_steiner_point()) == CGAL::ON_BOUNDARY) 
+                    ant.set_opposite_edge_projection(ant_opposite_edge);
             }
-            else ants[ant_index].set_reduce_obtuses(false);
-            curent_cdt = best_cdt;
-        }
+            else ant.set_reduce_obtuses(false);
+        });
 
         //Save the bests ants
         for (int ant_index = 0; ant_index < count_ants; ++ant_index){
             //If this ant didnt reduce the obtuses faces of cdt, ignore it
             if(!ants[ant_index].get_reduce_obtuses()) continue;
-            //Compare the best_cdt and ant_cdt to find the differnces in the faces.
-            /*If there are faces in best_cdt that ant_cdt does not have, this means that those faces were affected by ant*/
-            affected_faces(best_cdt, ants[ant_index]);
-            //Add this ant into ant_reduce_obtuses_vector
-            ant_reduce_obtuses_vector.emplace_back(ants[ant_index]);
+            //Add this ant into ant_reduce_obtuses_vector (the ants are initialized again at the end of the cycle)
+            ant_reduce_obtuses_vector.emplace_back(std::move(ants[ant_index]));
         }
         
         //If we had only 1 ant that improve the triangulation
@@ -660,8 +770,8 @@ void ant_colony(Custom_CDT& custom_cdt, Polygon& polygon, const double& alpha, c
 
         /*Save the best triangulation*/
         for(int i = 0; i < ant_last_winners_vector.size(); i++){
-            best_cdt.insert_no_flip(ant_last_winners_vector[i].get_steiner_point());
-            start_the_flips(best_cdt, polygon);
+            Vertex_handle steiner = best_cdt.insert_no_flip(ant_last_winners_vector[i].get_steiner_point());
+            start_the_flips(best_cdt, polygon, steiner);
             curent_steiner_point = ant_last_winners_vector[i].get_steiner_point();
             longest_edge = ant_last_winners_vector[i].get_longest_edge_midpoint();
             opposite_edge = ant_last_winners_vector[i].get_opposite_edge_projection();
@@ -680,30 +790,24 @@ void ant_colony(Custom_CDT& custom_cdt, Polygon& polygon, const double& alpha, c
         
         /*Update pheromones*/
         if(ant_reduce_obtuses_vector.size() > 0) updatePheromones(taf, delta_taf, ant_reduce_obtuses_vector, lamda);
+        //The replicas follow best_cdt
+        if (!ant_last_winners_vector.empty()) {
+            for (Custom_CDT& replica : replicas) replica = best_cdt;
+        }
         ///Restart the ants
-        Ant::initialize_Ants(ants, best_cdt);
+        Ant::initialize_Ants(ants);
     }
-    custom_cdt = best_cdt;
 }
 
-//Check for conflict between 2 ants
+//Check for conflict between 2 ants: both ants destroyed a same face of best_cdt
 bool have_conflict(Ant& ant1, Ant& ant2){
-    
-    set<Face_handle> temp_face = ant1.get_affected_faces();
-    set<Face_handle> temp_face2 = ant2.get_affected_faces();
-    
-    //Take the affected faces of the
-    set<Face_handle> face1 = ant1.get_affected_faces();
-    set<Face_handle> face2 = ant2.get_affected_faces();
-    int size_set1 = ant1.get_affected_faces().size();
-    int size_set2 = ant2.get_affected_faces().size();
-    //For every face of every of 2 ants check if they have same face(s)
-    for (const auto& temp_face1 : face1){
-        for (const auto& temp_face2 : face2){
-            if(are_faces_equal(temp_face1, temp_face2)){
-                return true;
-            }
-        }
+    const Face_key_set& faces1 = ant1.get_affected_faces();
+    const Face_key_set& faces2 = ant2.get_affected_faces();
+    //Look up the faces of the smaller set into the larger
+    const Face_key_set& smaller = (faces1.size() <= faces2.size()) ? faces1 : faces2;
+    const Face_key_set& larger = (faces1.size() <= faces2.size()) ? faces2 : faces1;
+    for (const Face_key& key : smaller){
+        if (larger.count(key)) return true;
     }
     return false;
 }
@@ -744,40 +848,14 @@ vector<Ant> save_the_best(vector<Ant>& ants){
     return winners;
 }
 
-//Check if two faces are equals
-bool are_faces_equal(const Face_handle& face1, const Face_handle& face2) {
-    set<Point_2> vertices_face1 = {
-        face1->vertex(0)->point(),
-        face1->vertex(1)->point(),
-        face1->vertex(2)->point()
-    };
-
-    set<Point_2> vertices_face2 = {
-        face2->vertex(0)->point(),
-        face2->vertex(1)->point(),
-        face2->vertex(2)->point()
-    };
-    //Copy the sets into vectors for sorting and comparison
-    vector<Point_2> points_vector_face1(vertices_face1.begin(), vertices_face1.end());
-    vector<Point_2> points_vector_face2(vertices_face2.begin(), vertices_face2.end());
-
-    //Lexicographical Order of the face points. First compare x-coordinates.
-    sort(points_vector_face1.begin(), points_vector_face1.end());
-    sort(points_vector_face2.begin(), points_vector_face2.end());
-
-    return points_vector_face1 == points_vector_face2;
-}
-
 //Give a random obtuse face
-Face_handle give_random_obtuse(Custom_CDT& custom_cdt, Polygon& polygon) {
+Face_handle give_random_obtuse(Custom_CDT& custom_cdt, Polygon& polygon, std::mt19937& generator) {
     //Container to store faces with obtuse angles
     vector<Face_handle> obtuse_faces;
-    //Initialize the random number generator with a random device and engine
-    static std::mt19937 generator(std::random_device{}()); //Only initialize once
 
     for (auto face = custom_cdt.finite_faces_begin(); face != custom_cdt.finite_faces_end(); ++face) {
         if (!is_face_inside_region(face, polygon)) continue;
-        if (is_obtuse(face)) {
+        if (custom_cdt.is_obtuse_face(face)) {
             obtuse_faces.push_back(face);
         }
     }
@@ -796,24 +874,6 @@ Face_handle give_random_obtuse(Custom_CDT& custom_cdt, Polygon& polygon) {
 }
 
 
-//Update affected faces
-void affected_faces(Custom_CDT& best_cdt, Ant& ant) {
-    ant.clear_ant_affect_faces();
-    Custom_CDT temp_ant_cdt = ant.get_Custom_CDT();
-    for (auto best_face = best_cdt.finite_faces_begin(); best_face != best_cdt.finite_faces_end(); ++best_face) {
-        bool found_face = false;
-        for (auto ant_face = temp_ant_cdt.finite_faces_begin(); ant_face != temp_ant_cdt.finite_faces_end(); ++ant_face) {
-            //Check the faces if are equals
-            if (are_faces_equal(best_face, ant_face)) {
-                found_face = true;
-                break;
-            }
-        }
-        //If best_face != ant_face means that we have conflict
-        if (!found_face) ant.set_face_in_ant_affect_faces(best_face);
-    }
-}
-
 void printAntDetails(vector<Ant>& ants) {
     cout<<"Number of ants: "<<ants.size() <<endl;
     for (size_t i = 0; i < ants.size(); ++i) {
@@ -827,16 +887,10 @@ void printAntDetails(vector<Ant>& ants) {
         cout<<"Conflict? : "<<ants[i].get_conflict()<<endl;
         
         if(ants[i].get_reduce_obtuses()){
-            set<Face_handle> temp_face = ants[i].get_affected_faces();
             cout<<"size of vector: "<<ants[i].get_affected_faces().size()<<endl;
-            for (const auto& face : temp_face) {
-                for (int j = 0; j < 3; ++j) {  //A triangle has 3 vertices
-                    cout<<endl;
-                    auto vertex = face->vertex(j);
-                    if (vertex != nullptr) cout<<"Point "<<j<<": ("<<vertex->point().x()<<", "<<vertex->point().y()<< ") =>";
-                    else cout<<"Point "<<j<< ": (nullptr)"<<endl;            
-                }
-                cout<<endl;
+            //The faces are printed with the ids of the points of their vertices
+            for (const Face_key& key : ants[i].get_affected_faces()) {
+                cout<<"Face: ("<<key[0]<<", "<<key[1]<<", "<<key[2]<<")"<<endl;
             }
         }
         cout<<"*******************************"<<endl;
@@ -844,7 +898,7 @@ void printAntDetails(vector<Ant>& ants) {
     }
 }
 
-SteinerMethod selectSteinerMethod(const double& ro, const vector<double>& taf, vector<double>& hta, double chi, double psi, bool obtuse_neighbors) {
+SteinerMethod selectSteinerMethod(const double& ro, const vector<double>& taf, vector<double>& hta, double chi, double psi, bool obtuse_neighbors, std::mt19937& gen) {
     //Ensure inputs are valid
     if (taf.size() != SteinerMethod::NUM_METHODS || hta.size() != SteinerMethod::NUM_METHODS) {
         cerr<<"Error: taf or hta size does not match NUM_METHODS."<<endl;
@@ -882,9 +936,7 @@ SteinerMethod selectSteinerMethod(const double& ro, const vector<double>& taf, v
     double correction = 1.0 - sum_probabilities;
     probabilities[SteinerMethod::NUM_METHODS - 1] += correction;
 
-    //Select a method based on the computed probabilities
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    //Select a method based on the computed probabilities (with the RNG of the caller's thread)
     std::uniform_real_distribution<> dis(0.0, 1.0);
     double random_value = dis(gen);
 
@@ -902,7 +954,7 @@ SteinerMethod selectSteinerMethod(const double& ro, const vector<double>& taf, v
     return static_cast<SteinerMethod>(SteinerMethod::NUM_METHODS - 1);
 }
 static int counter = 0;
-void updatePheromones(vector<double>& taf, vector<double>& delta_taf, vector<Ant> selected_ants, double lamda) {
+void updatePheromones(vector<double>& taf, vector<double>& delta_taf, const vector<Ant>& selected_ants, double lamda) {
     SteinerMethod sp;
     //If a method has been selected at least once, set a value of 1 in the same index of steinerMethod
     vector<int> num_of_methods(taf.size(), 0);
@@ -1019,13 +1071,14 @@ bool insert_circumcenter(Custom_CDT& circumcenter_cdt, const Face_handle& face,
     }
 
     //Compute the circumcenter of the triangle
-    Point_2 circumcenter = CGAL::circumcenter(p1, p2, p3);
+    Point_2 circumcenter = snap_point(CGAL::circumcenter(p1, p2, p3), circumcenter_cdt.snap_denominator());
     //Circumcenter must be inside of the boundary
     if (is_point_inside_region(circumcenter, polygon) && is_circumcenter_in_neighbor(circumcenter_cdt, face, circumcenter)){
         if(is_convex(p1, p2, p3, circumcenter)){
             circumcenter_steiner = circumcenter;
-            circumcenter_cdt.insert_no_flip(circumcenter);
-            start_the_flips(circumcenter_cdt, polygon);
+            //The circumcenter is in a neighbor of the face
+            Vertex_handle steiner = circumcenter_cdt.insert_no_flip(circumcenter, face);
+            start_the_flips(circumcenter_cdt, polygon, steiner);
             return true;
         }
         else return false;
@@ -1066,9 +1119,20 @@ void insert_centroid(Custom_CDT& centroid_cdt, const Face_handle& face, const Po
     Point_2 p3 = face->vertex(2)->point();
     //Compute the centroid of the triangle
     Point_2 centroid = CGAL::centroid(p1, p2, p3);
-    centroid_steiner = centroid;
-    centroid_cdt.insert_no_flip(centroid);
-    start_the_flips(centroid_cdt, polygon);
+    Vertex_handle steiner;
+    if (centroid_cdt.snap_denominator() > 0) {
+        //A snapped centroid can be out of a thin face (or out of the region)
+        centroid = snap_point(centroid, centroid_cdt.snap_denominator());
+        centroid_steiner = centroid;
+        if (!is_point_inside_region(centroid, polygon)) return;
+        steiner = centroid_cdt.insert_no_flip(centroid, face);
+    }
+    else {
+        centroid_steiner = centroid;
+        //The centroid is inside of the face
+        steiner = centroid_cdt.insert_no_flip(centroid, Custom_CDT::FACE, face, 0);
+    }
+    start_the_flips(centroid_cdt, polygon, steiner);
 }
 
 //Ιf we added steiner on boundary of the polygon, update the new edges of the polygon
@@ -1101,49 +1165,59 @@ int count_vertices(const Custom_CDT& cdt) {
     return count;
 }
 
+//The criterion of start_the_flips as one type for both overloads (the cdt remembers for which criterion it is settled)
+struct Region_flip_test {
+    const Custom_CDT& cdt;
+    const Polygon& polygon;
+    bool operator()(const Face_handle& f1, int i) const {
+        return should_flip_edge(cdt, f1, i, polygon);
+    }
+};
+
 //Flips method
-void start_the_flips(Custom_CDT& cdt, const Polygon& polygon){
-    bool progress = true;
-    while(progress){
-        progress = false;
-        for (auto edge = cdt.finite_edges_begin(); edge != cdt.finite_edges_end(); ++edge) {
-            Face_handle f1 = edge->first;
-            int i = edge->second;
-            Face_handle f2 = f1->neighbor(i);
+int start_the_flips(Custom_CDT& cdt, const Polygon& polygon){
+    Phase_timer timer(PHASE_FLIPS);
+    return cdt.flip_until_stable(Region_flip_test{cdt, polygon});
+}
 
-            if (cdt.is_infinite(f1) || cdt.is_infinite(f2)) continue;
-            
-            Point_2 p1 = f1->vertex(cdt.ccw(i))->point(); //First vertex on the shared edge (Counter-Clock Wise)
-            Point_2 p3 = f1->vertex(cdt.cw(i))->point();  //Second vertex on the shared edge (Clock Wise)
-            Point_2 p2 = f1->vertex(i)->point();          //Opposite vertex in the first triangle
-            //Check if edge is inside of the boundary
-            if(!is_edge_inside_region(p1, p3, polygon)) continue;
-
-            //Mirror index gets the opposite vertex of the second triangle (f2)
-            int mirror_index = cdt.mirror_index(f1, i);
-            Point_2 p4 = f2->vertex(mirror_index)->point(); 
-            //if the edge is constraints or on boundary
-            if (cdt.is_constrained(*edge) || is_edge_on_boundary(p1, p3, polygon)) continue;
-            
-            if(is_it_worth_flip(p1, p2, p3, p4)){
-                cdt.flip(f1, i);
-                progress = true;
-                break;
-            }
-            else continue;
-        }
-    }
+//Flips after the insertion of steiner, only the faces around the steiner have changed (if the cdt was settled before)
+int start_the_flips(Custom_CDT& cdt, const Polygon& polygon, Vertex_handle steiner){
+    Phase_timer timer(PHASE_FLIPS);
+    return cdt.flip_until_stable(Region_flip_test{cdt, polygon}, steiner);
+}
+
+//Flip criterion of start_the_flips for the edge (f1, i)
+bool should_flip_edge(const Custom_CDT& cdt, const Face_handle& f1, int i, const Polygon& polygon){
+    Face_handle f2 = f1->neighbor(i);
+
+    if (cdt.is_infinite(f1) || cdt.is_infinite(f2)) return false;
+    
+    Point_2 p1 = f1->vertex(cdt.ccw(i))->point(); //First vertex on the shared edge (Counter-Clock Wise)
+    Point_2 p3 = f1->vertex(cdt.cw(i))->point();  //Second vertex on the shared edge (Clock Wise)
+    Point_2 p2 = f1->vertex(i)->point();          //Opposite vertex in the first triangle
+    //Check if edge is inside of the boundary (one of its faces is inside of the region)
+    if(!f1->info().in_region && !f2->info().in_region) return false;
+
+    //Mirror index gets the opposite vertex of the second triangle (f2)
+    int mirror_index = cdt.mirror_index(f1, i);
+    Point_2 p4 = f2->vertex(mirror_index)->point(); 
+    //if the edge is constraints or on boundary
+    if (cdt.is_constrained(make_pair(f1, i)) || is_edge_on_boundary(f1, i)) return false;
+    
+    return is_it_worth_flip(p1, p2, p3, p4);
 }
 
 
 //If 1 point is on the boundary
 bool is_point_inside_region(const Point_2& point, const Polygon& polygon) {
+    INSTRUMENT_COUNT(COUNTER_BOUNDED_SIDE);
     //Check if the point is inside the polygon
     return (polygon.bounded_side(point) == CGAL::ON_BOUNDED_SIDE) || (polygon.bounded_side(point) == CGAL::ON_BOUNDARY);
 }
 
 //If face is inside of region boundary
 bool is_face_inside_region(const Face_handle& face, const Polygon& polygon) {
+    INSTRUMENT_COUNT(COUNTER_REGION_TESTS);
     Point_2 p1 = face->vertex(0)->point();
     Point_2 p2 = face->vertex(1)->point();
     Point_2 p3 = face->vertex(2)->point();
@@ -1153,40 +1227,23 @@ bool is_face_inside_region(const Face_handle& face, const Polygon& polygon) {
         return false;
     }
 
-    //Check if the triangle's vertices and midpoints are inside the region
-    bool vertices_inside = (polygon.bounded_side(p1) == CGAL::ON_BOUNDED_SIDE || polygon.bounded_side(p1) == CGAL::ON_BOUNDARY) &&
-                           (polygon.bounded_side(p2) == CGAL::ON_BOUNDED_SIDE || polygon.bounded_side(p2) == CGAL::ON_BOUNDARY) &&
-                           (polygon.bounded_side(p3) == CGAL::ON_BOUNDED_SIDE || polygon.bounded_side(p3) == CGAL::ON_BOUNDARY);
-
-    bool midpoints_inside = 
-        (polygon.bounded_side(CGAL::midpoint(p1, p2)) == CGAL::ON_BOUNDED_SIDE || polygon.bounded_side(CGAL::midpoint(p1, p2)) == CGAL::ON_BOUNDARY) &&
-        (polygon.bounded_side(CGAL::midpoint(p1, p3)) == CGAL::ON_BOUNDED_SIDE || polygon.bounded_side(CGAL::midpoint(p1, p3)) == CGAL::ON_BOUNDARY) &&
-        (polygon.bounded_side(CGAL::midpoint(p2, p3)) == CGAL::ON_BOUNDED_SIDE || polygon.bounded_side(CGAL::midpoint(p2, p3)) == CGAL::ON_BOUNDARY);
-
-    return vertices_inside && midpoints_inside;
+    //The region flag of the face (set by mark_region_faces and kept by the insertions and the flips)
+    return face->info().in_region;
 }
 
-//Found if this face is on the boundary!!
-//If one edge of the face lies into cdt boundary => the face is face on boundary
-bool is_face_on_boundary(const Custom_CDT& cdt, Face_handle face, const Polygon& polygon) {
-    //Loop through each edge of the face
-    for (int i = 0; i < 3; ++i) {
-        //Get the two endpoints of the edge
-        Point_2 p1 = face->vertex(cdt.cw(i))->point();
-        Point_2 p2 = face->vertex(cdt.ccw(i))->point();
-
-        //Check if this edge lies on the boundary of the polygon or if one neighbor of this edge is the infinite face
-
-        if (is_edge_on_boundary(p1, p2, polygon) || cdt.is_infinite(face->neighbor(i))) {
-            return true; // he face is on the boundary of the polygon
-        }
-    }
-    return false; //None of the edges lie on the polygon boundary
+//Mark the faces of the cdt that are inside of the region boundary.
+//The edges of the region boundary must be constraints of the cdt
+void mark_region_faces(Custom_CDT& cdt, const Polygon& polygon) {
+    cdt.mark_region([&](const Face_handle& face, int i){
+        Point_2 p1 = face->vertex(cdt.ccw(i))->point();
+        Point_2 p2 = face->vertex(cdt.cw(i))->point();
+        return polygon.bounded_side(CGAL::midpoint(p1, p2)) == CGAL::ON_BOUNDARY;
+    });
 }
 
-
 //If edge is inside of region boundary
 bool is_edge_inside_region(const Point_2& p1, const Point_2& p2, const Polygon& polygon){
+    INSTRUMENT_COUNT(COUNTER_BOUNDED_SIDE);
     bool mids_inside_region = 
         (polygon.bounded_side(CGAL::midpoint(p1, p2)) == CGAL::ON_BOUNDED_SIDE || polygon.bounded_side(CGAL::midpoint(p1, p2)) == CGAL::ON_BOUNDARY);
     bool points_inside_region = 
@@ -1196,6 +1253,13 @@ bool is_edge_inside_region(const Point_2& p1, const Point_2& p2, const Polygon&
 }
 
 
+//O(1) check if the edge (face, i) is part of the boundary of the region:
+//the boundary edges are the edges between a face inside and a face outside of the region.
+//A steiner that splits a boundary edge keeps the flags, so there is nothing to update with update_polygon
+bool is_edge_on_boundary(const Face_handle& face, int i) {
+    return face->info().in_region != face->neighbor(i)->info().in_region;
+}
+
 //Function to check if an edge is part of the boundary of the polygon
 bool is_edge_on_boundary(const Point_2& p1, const Point_2& p2, const Polygon& polygon) {
     for (auto edge_it = polygon.edges_begin(); edge_it != polygon.edges_end(); ++edge_it) {
@@ -1209,14 +1273,11 @@ bool is_edge_on_boundary(const Point_2& p1, const Point_2& p2, const Polygon& po
 
 
 Point_2 find_obtuse_vertex(const Point_2& v1, const Point_2& v2, const Point_2& v3) {
-    //Calculate squared distances
-    double ab2 = CGAL::to_double(squared_distance(v1, v2));
-    double ac2 = CGAL::to_double(squared_distance(v1, v3));
-    double bc2 = CGAL::to_double(squared_distance(v2, v3));
-
-    if (ab2 + ac2 < bc2) return v1; // obtuse angle at v1
-    if (ab2 + bc2 < ac2) return v2; // obtuse angle at v2
-    if (ac2 + bc2 < ab2) return v3; // obtuse angle at v3
+    //Same filtered predicate as is_obtuse, so the two always agree
+    int obtuse_index = obtuse_vertex_index(v1, v2, v3);
+    if (obtuse_index == 0) return v1; // obtuse angle at v1
+    if (obtuse_index == 1) return v2; // obtuse angle at v2
+    if (obtuse_index == 2) return v3; // obtuse angle at v3
 
     throw logic_error("No obtuse angle found in the triangle.");
 }
@@ -1247,6 +1308,15 @@ Segment_2 find_longest_edge(const Face_handle& face) {
     }
 }
 
+//Index of the vertex of the face that is opposite to the edge (an edge of the face)
+int opposite_vertex_index(const Face_handle& face, const Segment_2& edge) {
+    for (int i = 0; i < 3; ++i) {
+        const Point_2& p = face->vertex(i)->point();
+        if (p != edge.source() && p != edge.target()) return i;
+    }
+    return -1;
+}
+
 void print_polygon_edges(const Polygon& polygon){
     cout << "Polygon edges:\n";
     for (auto it = polygon.edges_begin(); it != polygon.edges_end(); ++it) {
@@ -1276,71 +1346,34 @@ bool is_polygon_convex(const set<Point_2>& unique_points) {
 }
 
 //Function to check if a vertex in custom_cdt is a Steiner point
-bool is_steiner_point(Vertex_handle vertex, const vector<Point_2>& original_points) {
-    const Point_2& vertex_point = vertex->point();
-    //Check if vertex_point is in the original_points vector
-    return find(original_points.begin(), original_points.end(), vertex_point) == original_points.end();
+//The vertices of the input points have their input index (set when the cdt is built), every other vertex is a steiner
+bool is_steiner_point(Vertex_handle vertex) {
+    return vertex->info().input_index < 0;
 }
 
 
-void output(value jv, Custom_CDT custom_cdt, vector<Point_2> original_points, int obtuse_count, std_string output_path){
-    //Get instance_uid from input JSON
-    std_string instance_uid = jv.as_object().at("instance_uid").as_string().c_str();
-
-    //Extract method & parameters
-    std_string method = jv.as_object().at("method").as_string().c_str();
-    boost::json::object parameters = jv.as_object().at("parameters").as_object();
-
-    //Prepare steiner points lists
-    vector<std_string> steiner_points_x;
-    vector<std_string> steiner_points_y;
-
-    for (auto vertex = custom_cdt.finite_vertices_begin(); vertex != custom_cdt.finite_vertices_end(); ++vertex){
-        // if a vertex is not found in the initial points then it must be a steiner point
-        if (is_steiner_point(vertex, original_points)){
-            const Point_2& p = vertex->point();
-            steiner_points_x.push_back(convert_to_string(p.x())); //Store x-coordinate as string
-            steiner_points_y.push_back(convert_to_string(p.y())); //Store y-coordinate as string
-        }
-    }
-    
-    //Convert steiner_points_x and steiner_points_y to JSON-compatible format
-    boost::json::array steiner_points_x_json;
-    boost::json::array steiner_points_y_json;
-
-    for (const auto &x : steiner_points_x){
-        steiner_points_x_json.push_back(boost::json::value(x));
-    }
-
-    for (const auto &y : steiner_points_y){
-        steiner_points_y_json.push_back(boost::json::value(y));
-    }
-
-    //Prepare edges list
-    vector<pair<int, int>> edges;
-    std::map<Vertex_handle, int> vertex_index_map;
-    int index = 0;
-
-    //Map vertices to unique indices
-    for (auto vertex = custom_cdt.finite_vertices_begin(); vertex != custom_cdt.finite_vertices_end(); ++vertex){
-        vertex_index_map[vertex] = index++;
+//Write the solution file. The triangulation is streamed into the file, nothing is copied or built in memory before
+bool output(const value& jv, const Custom_CDT& custom_cdt, const vector<Point_2>& original_points, int obtuse_count, const std_string& output_path){
+    Buffered_writer file(output_path);
+    if (file.failed()) {
+        cerr<<"Error opening file: "<<output_path<<endl;
+        return false;
     }
-
-    //Collect edges
-    for (auto edge = custom_cdt.finite_edges_begin(); edge != custom_cdt.finite_edges_end(); ++edge){
-        auto v1 = edge->first->vertex((edge->second + 1) % 3);
-        auto v2 = edge->first->vertex((edge->second + 2) % 3);
-        edges.emplace_back(vertex_index_map[v1], vertex_index_map[v2]);
+    output(jv, custom_cdt, original_points, obtuse_count, file);
+    if (!file.close()) {
+        cerr<<"Error writing file: "<<output_path<<endl;
+        return false;
     }
+    cout<<"Solution JSON file written as "<<output_path<<endl;
+    return true;
+}
 
-    //Convert to JSON arrays
-    boost::json::array edges_json, parameters_json;
-
-    for (const auto &edge : edges)
-        edges_json.push_back(boost::json::array{edge.first, edge.second});
-
+//The solution json into any writer (a file or a socket), false if a write failed
+bool output(const value& jv, const Custom_CDT& custom_cdt, const vector<Point_2>& original_points, int obtuse_count, Buffered_writer& file){
+    const auto& input = jv.as_object();
     //Convert parameters to JSON
-    for (const auto &[key, value] : parameters){
+    boost::json::array parameters_json;
+    for (const auto &[key, value] : input.at("parameters").as_object()){
         if (value.is_double()) {
             //Convert double values to a formatted string
             parameters_json.push_back(boost::json::object{{key, format_double(value.as_double())}});
@@ -1350,26 +1383,42 @@ void output(value jv, Custom_CDT custom_cdt, vector<Point_2> original_points, in
             parameters_json.push_back(boost::json::object{{key, value}});
         }
     }
-  
-    //make the json file look pretty (not in a single line)
-    ostringstream json_output;
-    json_output<<"{\n";
-    json_output<<"  \"content_type\": \"CG_SHOP_2025_Solution\",\n";
-    json_output<<"  \"instance_uid\": \""<< instance_uid<<"\",\n";
-    json_output<<"  \"steiner_points_x\": "<<boost::json::serialize(steiner_points_x_json)<<",\n";
-    json_output<<"  \"steiner_points_y\": "<<boost::json::serialize(steiner_points_y_json)<<",\n";
-    json_output<<"  \"edges\": "<<boost::json::serialize(edges_json)<<",\n";
-    json_output<<"  \"obtuse_count\": \"" <<obtuse_count<<"\",\n";
-    json_output<<"  \"method\": \"" <<method<<"\",\n";
-    json_output<<"  \"parameters\": "<<parameters_json<<"\n";
-    json_output<<"}\n";
-    
-    //Write to file
-    ofstream output_file(output_path);
-    output_file<<json_output.str();
-    output_file.close();
 
-    cout<<"Solution JSON file written as solution_output.json"<<endl;
+    file<<"{\n";
+    file<<"  \"content_type\": \"CG_SHOP_2025_Solution\",\n";
+    file<<"  \"instance_uid\": \""<<input.at("instance_uid").as_string().c_str()<<"\",\n";
+
+    //Steiner points (the x and the y coordinates are separate arrays), in the order of their steiner_index
+    for (int coordinate = 0; coordinate < 2; ++coordinate) {
+        file<<(coordinate == 0 ? "  \"steiner_points_x\": [" : "  \"steiner_points_y\": [");
+        bool first = true;
+        for (const Vertex_handle& vertex : custom_cdt.steiner_vertices()){
+            const Point_2& p = vertex->point();
+            file<<(first ? "\"" : ",\"")<<convert_to_string(coordinate == 0 ? p.x() : p.y())<<'"';
+            first = false;
+        }
+        file<<"],\n";
+    }
+
+    //Edges: the points of the solution are the input points and then the steiner points
+    const int number_of_points = original_points.size();
+    auto solution_index = [&](Vertex_handle vertex){
+        return is_steiner_point(vertex) ? number_of_points + vertex->info().steiner_index : vertex->info().input_index;
+    };
+    file<<"  \"edges\": [";
+    bool first = true;
+    for (auto edge = custom_cdt.finite_edges_begin(); edge != custom_cdt.finite_edges_end(); ++edge){
+        auto v1 = edge->first->vertex((edge->second + 1) % 3);
+        auto v2 = edge->first->vertex((edge->second + 2) % 3);
+        file<<(first ? "[" : ",[")<<solution_index(v1)<<','<<solution_index(v2)<<']';
+        first = false;
+    }
+    file<<"],\n";
+    file<<"  \"obtuse_count\": \""<<obtuse_count<<"\",\n";
+    file<<"  \"method\": \""<<input.at("method").as_string().c_str()<<"\",\n";
+    file<<"  \"parameters\": "<<boost::json::serialize(parameters_json)<<"\n";
+    file<<"}\n";
+    return !file.failed();
 }
 
 //Function to format double values as strings
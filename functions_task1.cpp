@@ -21,9 +21,7 @@ double squared_distance_1(const Point_2 &a, const Point_2 &b)
 
 bool is_obtuse(const Point_2 &a, const Point_2 &b, const Point_2 &c)
 {
-    return (CGAL::angle(a, b, c) == CGAL::OBTUSE ||
-            CGAL::angle(b, a, c) == CGAL::OBTUSE ||
-            CGAL::angle(a, c, b) == CGAL::OBTUSE);
+    return obtuse_vertex_index(a, b, c) >= 0;
 }
 
 //Read JSON file
@@ -63,24 +61,12 @@ bool is_in_region_boundary(const std::pair<int, int> &edge, const vector<int> &b
 }*/
 
 //Just count the number of obtuses triangles in a cdt
-int count_obtuse_triangles_1(CDT &cdt, const Polygon &polygon)
+int count_obtuse_triangles_1(Custom_CDT &cdt, const Polygon &polygon)
 {
-    int obtuse_count = 0;
-    for (auto fit = cdt.finite_faces_begin(); fit != cdt.finite_faces_end(); ++fit)
-    {
-        Point_2 p1 = fit->vertex(0)->point();
-        Point_2 p2 = fit->vertex(1)->point();
-        Point_2 p3 = fit->vertex(2)->point();
-
-        if (is_obtuse(p1, p2, p3) &&
-            polygon.bounded_side(CGAL::midpoint(p1, p2)) != CGAL::ON_UNBOUNDED_SIDE &&
-            polygon.bounded_side(CGAL::midpoint(p1, p3)) != CGAL::ON_UNBOUNDED_SIDE &&
-            polygon.bounded_side(CGAL::midpoint(p2, p3)) != CGAL::ON_UNBOUNDED_SIDE)
-        {
-            obtuse_count++;
-        }
-    }
-    return obtuse_count;
+    Phase_timer timer(PHASE_COUNTING);
+    // The midpoints of the edges are in the region exactly for the faces inside of the region,
+    // so these are the obtuse faces with the region flag that the cdt counts
+    return cdt.number_of_obtuse_faces_in_region();
 }
 
 // Return true if 2 faces (two triangles) form a convex polygon
@@ -149,22 +135,25 @@ void insert_midpoint_1(Custom_CDT &custom_cdt, const Polygon &polygon)
 
             if (is_obtuse(p1, p2, p3))
             {
-                Custom_CDT simulation = custom_cdt;
                 CGAL::Segment_2 longest_edge = find_longest_edge(p1, p2, p3);
-                Point_2 midpoint = CGAL::midpoint(longest_edge.source(), longest_edge.target());
+                Point_2 exact_midpoint = CGAL::midpoint(longest_edge.source(), longest_edge.target());
+                // Snapped to the grid, or exact if the longest edge (opposite to the obtuse vertex) is constrained
+                Point_2 midpoint = snaps_off_edge(custom_cdt, face, obtuse_vertex_index(p1, p2, p3)) ? snap_point(exact_midpoint, custom_cdt.snap_denominator()) : flatten_point(exact_midpoint, custom_cdt.snap_denominator());
 
                 if (is_point_inside_region(midpoint, polygon))
                 {
-                    int obtuses_before = count_obtuse_triangles_1(simulation, polygon);
-                    simulation.insert_no_flip(midpoint);
-                    start_the_flips_1(simulation, polygon);
-                    if (obtuses_before > count_obtuse_triangles_1(simulation, polygon))
+                    int obtuses_before = count_obtuse_triangles_1(custom_cdt, polygon);
+                    // Simulate the insertion, keep it only if it reduces the obtuses
+                    custom_cdt.begin_transaction();
+                    Vertex_handle steiner = custom_cdt.insert_no_flip(midpoint, face);
+                    start_the_flips_1(custom_cdt, polygon, steiner);
+                    if (obtuses_before > count_obtuse_triangles_1(custom_cdt, polygon))
                     {
-                        custom_cdt.insert_no_flip(midpoint);
-                        start_the_flips_1(custom_cdt, polygon);
+                        custom_cdt.commit_transaction();
                         progress = true;
                         break;
                     }
+                    custom_cdt.rollback_transaction();
                 }
             }
             if (count_obtuse_triangles_1(custom_cdt, polygon) == 0)
@@ -188,27 +177,27 @@ void insert_orthocenter_1(Custom_CDT &custom_cdt, const Polygon &polygon)
             // Check if the triangle is obtuse
             if (is_obtuse(p1, p2, p3))
             {
-                Custom_CDT simulation = custom_cdt;
                 Point_2 obtuse_vertex = find_obtuse_vertex_1(p1, p2, p3);
 
                 // Calculate the orthocenter of the obtuse triangle
-                Point_2 orthocenter = find_orthocenter(p1, p2, p3);
+                Point_2 orthocenter = snap_point(find_orthocenter(p1, p2, p3), custom_cdt.snap_denominator());
 
                 // Verify if the orthocenter point can be inserted
                 if (is_point_inside_region(orthocenter, polygon))
                 {
-                    int obtuses_before = count_obtuse_triangles_1(simulation, polygon);
-                    simulation.insert_no_flip(orthocenter);
-                    start_the_flips_1(simulation, polygon);
+                    int obtuses_before = count_obtuse_triangles_1(custom_cdt, polygon);
+                    custom_cdt.begin_transaction();
+                    Vertex_handle steiner = custom_cdt.insert_no_flip(orthocenter, face);
+                    start_the_flips_1(custom_cdt, polygon, steiner);
 
                     // Check if insertion of orthocenter reduces obtuse triangles
-                    if (obtuses_before > count_obtuse_triangles_1(simulation, polygon))
+                    if (obtuses_before > count_obtuse_triangles_1(custom_cdt, polygon))
                     {
-                        custom_cdt.insert_no_flip(orthocenter);
-                        start_the_flips_1(custom_cdt, polygon);
+                        custom_cdt.commit_transaction();
                         progress = true;
                         break;
                     }
+                    custom_cdt.rollback_transaction();
                 }
             }
             if (count_obtuse_triangles_1(custom_cdt, polygon) == 0)
@@ -256,50 +245,47 @@ void insert_projection_1(Custom_CDT &custom_cdt, const Polygon polygon)
                     opposite2 = p2;
                 }
                 Line_2 line(opposite1, opposite2);
-                Point_2 projected_point = line.projection(obtuse_angle_vertex);
-                // Copy the cdt for simulation
-                Custom_CDT simulation = custom_cdt;
+                Point_2 projection = line.projection(obtuse_angle_vertex);
+                // Snapped to the grid, or along the opposite edge if it is constrained
+                Point_2 projected_point = snaps_off_edge(custom_cdt, face, obtuse_vertex_index(p1, p2, p3)) ? snap_point(projection, custom_cdt.snap_denominator()) : snap_on_segment(opposite1, opposite2, projection, custom_cdt.snap_denominator());
                 bool insert_projection = is_point_inside_region(projected_point, polygon);
 
-                int obtuses_before = count_obtuse_triangles_1(simulation, polygon);
+                int obtuses_before = count_obtuse_triangles_1(custom_cdt, polygon);
                 // Itarate all the faces of the boundary. If the point in side (not on) of the boundary is obtuse, insert projection
                 if (fill_boundary && insert_projection)
                 {
                     if (is_face_on_boundary(custom_cdt, face) && !(polygon.bounded_side(obtuse_angle_vertex) == CGAL::ON_BOUNDARY))
                     {
-                        simulation.insert_no_flip(projected_point);
-                        start_the_flips_1(simulation, polygon);
-                        if (obtuses_before > count_obtuse_triangles_1(simulation, polygon))
-                        {
-                            /*Original insertion of Projection*/
-                            custom_cdt.insert_no_flip(projected_point);
-                            start_the_flips_1(custom_cdt, polygon);
-                        }
+                        // Simulate the insertion, keep it only if it reduces the obtuses
+                        custom_cdt.begin_transaction();
+                        Vertex_handle steiner = custom_cdt.insert_no_flip(projected_point, face);
+                        start_the_flips_1(custom_cdt, polygon, steiner);
+                        if (obtuses_before > count_obtuse_triangles_1(custom_cdt, polygon))
+                            custom_cdt.commit_transaction();
+                        else
+                            custom_cdt.rollback_transaction();
                     }
                 }
                 // main case, not only the boundary faces
                 else if (insert_projection)
                 {
-                    simulation.insert(projected_point);
-                    start_the_flips_1(simulation, polygon);
+                    // The simulation inserts with Delaunay flips, the original insertion without,
+                    // so the simulation is always taken back
+                    custom_cdt.begin_transaction();
+                    Vertex_handle steiner = custom_cdt.insert(projected_point, face);
+                    start_the_flips_1(custom_cdt, polygon, steiner);
+                    int obtuses_after = count_obtuse_triangles_1(custom_cdt, polygon);
+                    bool boundary_neighbor = false;
 
-                    if (obtuses_before > count_obtuse_triangles_1(simulation, polygon))
-                    {
-                        /*Original insertion of Projection*/
-                        custom_cdt.insert_no_flip(projected_point);
-                        start_the_flips_1(custom_cdt, polygon);
-                        progress = true;
-                        break;
-                    }
                     // Case the projection point reduce -1 the obtuse angle, but make new obtuse angle in the neighbor
                     // If this neighbor is boundary face (at least 2 points lies in the boundary polygon) and the projection point
                     // is part of this face but is in (not on) the boundary, add the projection
-                    else if (obtuses_before == count_obtuse_triangles_1(simulation, polygon))
+                    if (obtuses_before == obtuses_after)
                     {
 
-                        for (auto sim_face = simulation.finite_faces_begin(); sim_face != simulation.finite_faces_end(); ++sim_face)
+                        for (auto sim_face = custom_cdt.finite_faces_begin(); sim_face != custom_cdt.finite_faces_end(); ++sim_face)
                         {
-                            if (simulation.is_infinite(sim_face))
+                            if (custom_cdt.is_infinite(sim_face))
                                 continue;
 
                             // Check if the projected point is part of a boundary face
@@ -307,22 +293,36 @@ void insert_projection_1(Custom_CDT &custom_cdt, const Polygon polygon)
                                 sim_face->vertex(1)->point() == projected_point ||
                                 sim_face->vertex(2)->point() == projected_point)
                             {
-                                if (is_face_on_boundary(simulation, sim_face))
+                                if (is_face_on_boundary(custom_cdt, sim_face))
                                 {
                                     if (is_obtuse(sim_face->vertex(0)->point(), sim_face->vertex(1)->point(), sim_face->vertex(2)->point()))
                                     {
-                                        // Insert into the original triangulation
-                                        custom_cdt.insert_no_flip(projected_point);
-                                        start_the_flips_1(custom_cdt, polygon);
-                                        progress = true;
-                                        //"call" the fill boundary case
-                                        fill_boundary = true;
+                                        boundary_neighbor = true;
                                         break;
                                     }
                                 }
                             }
                         }
                     }
+                    custom_cdt.rollback_transaction();
+
+                    if (obtuses_before > obtuses_after)
+                    {
+                        /*Original insertion of Projection*/
+                        Vertex_handle steiner = custom_cdt.insert_no_flip(projected_point, face);
+                        start_the_flips_1(custom_cdt, polygon, steiner);
+                        progress = true;
+                        break;
+                    }
+                    else if (boundary_neighbor)
+                    {
+                        // Insert into the original triangulation
+                        Vertex_handle steiner = custom_cdt.insert_no_flip(projected_point, face);
+                        start_the_flips_1(custom_cdt, polygon, steiner);
+                        progress = true;
+                        //"call" the fill boundary case
+                        fill_boundary = true;
+                    }
                 }
             }
             // when the case of itaration of boundary faces ends
@@ -356,6 +356,12 @@ bool is_edge_in_boundary(const Point_2 &p1, const Point_2 &p2, const Polygon &po
     return false;
 }
 
+// Same check for an edge of the cdt: its two faces are on different sides of the region boundary
+bool is_edge_in_boundary(const Face_handle &face, int i)
+{
+    return face->info().in_region != face->neighbor(i)->info().in_region;
+}
+
 // Ιnsert Steiner points at circumcenters
 void insert_circumcenter_centroid_1(Custom_CDT &custom_cdt, const Polygon &polygon)
 {
@@ -374,40 +380,40 @@ void insert_circumcenter_centroid_1(Custom_CDT &custom_cdt, const Polygon &polyg
             {
                 // Compute the circumcenter of the triangle
                 Face_handle triangleA = face;
-                Point circumcenter = CGAL::circumcenter(p1, p2, p3);
+                Point circumcenter = snap_point(CGAL::circumcenter(p1, p2, p3), custom_cdt.snap_denominator());
                 if (is_point_inside_region(circumcenter, polygon))
                 {
-                    Custom_CDT simulation = custom_cdt;
                     if (is_convex_1(p1, p2, p3, circumcenter))
                     {
                         int initial_obtuse_count = count_obtuse_triangles_1(custom_cdt, polygon);
                         /*Simulate circumcenter insertion*/
-                        simulation.insert_no_flip(circumcenter);
-                        start_the_flips_1(simulation, polygon);
-                        int final_obtuse_count = count_obtuse_triangles_1(simulation, polygon);
+                        custom_cdt.begin_transaction();
+                        Vertex_handle steiner = custom_cdt.insert_no_flip(circumcenter, face);
+                        start_the_flips_1(custom_cdt, polygon, steiner);
+                        int final_obtuse_count = count_obtuse_triangles_1(custom_cdt, polygon);
 
                         // Check if the flip resolved obtuse angles in the two faces
                         if (final_obtuse_count < initial_obtuse_count)
                         {
-                            /*Original circumcenter insertion*/
-                            custom_cdt.insert_no_flip(circumcenter);
-                            start_the_flips_1(custom_cdt, polygon);
+                            /*Keep the circumcenter insertion*/
+                            custom_cdt.commit_transaction();
                             progress = true;
-                            final_obtuse_count = count_obtuse_triangles_1(custom_cdt, polygon);
                             break;
                         }
+                        custom_cdt.rollback_transaction();
                     }
                 }
                 else
                 {
                     // Cetroid case (if circumcenter went out of bounds)
-                    Point_2 centroid = CGAL::centroid(p1, p2, p3);
-                    bool insert_centroid = can_insert_centroid(custom_cdt, triangleA, centroid, polygon);
+                    Point_2 centroid = snap_point(CGAL::centroid(p1, p2, p3), custom_cdt.snap_denominator());
+                    // A snapped centroid can be out of the region
+                    bool insert_centroid = is_point_inside_region(centroid, polygon) && can_insert_centroid(custom_cdt, triangleA, centroid, polygon);
                     // Just check if the insertion of centroid has a benefit
                     if (insert_centroid)
                     {
-                        custom_cdt.insert(centroid);
-                        start_the_flips_1(custom_cdt, polygon);
+                        Vertex_handle steiner = custom_cdt.insert(centroid);
+                        start_the_flips_1(custom_cdt, polygon, steiner);
                         progress = true;
                         break;
                     }
@@ -420,17 +426,18 @@ void insert_circumcenter_centroid_1(Custom_CDT &custom_cdt, const Polygon &polyg
 // Just simulate if insert centroid (and auto flips) we reduce the obtuses
 bool can_insert_centroid(Custom_CDT &custom_cdt, Face_handle &triangleA, const Point_2 &centroid, const Polygon &polygon)
 {
-    Custom_CDT simulation = custom_cdt;
     // Get the vertices of triangle A
     Point_2 p1 = triangleA->vertex(0)->point();
     Point_2 p2 = triangleA->vertex(1)->point();
     Point_2 p3 = triangleA->vertex(2)->point();
 
     int initial_obtuse_count = count_obtuse_triangles_1(custom_cdt, polygon);
-    /*Simulate centroid insertion*/
-    simulation.insert(centroid);
-    start_the_flips_1(simulation, polygon);
-    int final_obtuse_count = count_obtuse_triangles_1(simulation, polygon);
+    /*Simulate centroid insertion, and take it back*/
+    custom_cdt.begin_transaction();
+    Vertex_handle steiner = custom_cdt.insert(centroid);
+    start_the_flips_1(custom_cdt, polygon, steiner);
+    int final_obtuse_count = count_obtuse_triangles_1(custom_cdt, polygon);
+    custom_cdt.rollback_transaction();
 
     // Check if the number of obtuse triangles decreased or stayed the same
     if (final_obtuse_count < initial_obtuse_count)
@@ -439,41 +446,49 @@ bool can_insert_centroid(Custom_CDT &custom_cdt, Face_handle &triangleA, const P
         return false;
 }
 
-void start_the_flips_1(Custom_CDT &cdt, const Polygon &polygon)
+// The criterion of start_the_flips_1 as one type for both overloads (the cdt remembers for which criterion it is settled)
+struct Flip_test_1
 {
-    bool progress = true;
-    while (progress)
+    const Custom_CDT &cdt;
+    const Polygon &polygon;
+    bool operator()(const Face_handle &f1, int i) const
     {
-        progress = false;
-        for (auto edge = cdt.finite_edges_begin(); edge != cdt.finite_edges_end(); ++edge)
-        {
-            CDT::Face_handle f1 = edge->first;
-            int i = edge->second;
-            CDT::Face_handle f2 = f1->neighbor(i);
-
-            if (cdt.is_infinite(f1) || cdt.is_infinite(f2))
-                continue;
-
-            Point_2 p1 = f1->vertex(cdt.ccw(i))->point(); // First vertex on the shared edge (Counter-Clock Wise)
-            Point_2 p3 = f1->vertex(cdt.cw(i))->point();  // Second vertex on the shared edge (Clock Wise)
-            Point_2 p2 = f1->vertex(i)->point();          // Opposite vertex in the first triangle
-            // Mirror index gets the opposite vertex of the second triangle (f2)
-            int mirror_index = cdt.mirror_index(f1, i);
-            Point_2 p4 = f2->vertex(mirror_index)->point();
-            // if the eddge is constraints or is on
-            if (cdt.is_constrained(*edge) || is_edge_in_boundary(p1, p3, polygon))
-                continue;
-
-            if (can_flip(p1, p2, p3, p4))
-            {
-                cdt.flip(f1, i);
-                progress = true;
-                break;
-            }
-            else
-                continue;
-        }
+        return should_flip_edge_1(cdt, f1, i, polygon);
     }
+};
+
+int start_the_flips_1(Custom_CDT &cdt, const Polygon &polygon)
+{
+    Phase_timer timer(PHASE_FLIPS);
+    return cdt.flip_until_stable(Flip_test_1{cdt, polygon});
+}
+
+// Flips after the insertion of a steiner, only the faces around the steiner have changed (if the cdt was settled before)
+int start_the_flips_1(Custom_CDT &cdt, const Polygon &polygon, Vertex_handle steiner)
+{
+    Phase_timer timer(PHASE_FLIPS);
+    return cdt.flip_until_stable(Flip_test_1{cdt, polygon}, steiner);
+}
+
+// Flip criterion of start_the_flips_1 for the edge (f1, i)
+bool should_flip_edge_1(const Custom_CDT &cdt, const Face_handle &f1, int i, const Polygon &polygon)
+{
+    Face_handle f2 = f1->neighbor(i);
+
+    if (cdt.is_infinite(f1) || cdt.is_infinite(f2))
+        return false;
+
+    Point_2 p1 = f1->vertex(cdt.ccw(i))->point(); // First vertex on the shared edge (Counter-Clock Wise)
+    Point_2 p3 = f1->vertex(cdt.cw(i))->point();  // Second vertex on the shared edge (Clock Wise)
+    Point_2 p2 = f1->vertex(i)->point();          // Opposite vertex in the first triangle
+    // Mirror index gets the opposite vertex of the second triangle (f2)
+    int mirror_index = cdt.mirror_index(f1, i);
+    Point_2 p4 = f2->vertex(mirror_index)->point();
+    // if the eddge is constraints or is on
+    if (cdt.is_constrained(std::make_pair(f1, i)) || is_edge_in_boundary(f1, i))
+        return false;
+
+    return can_flip(p1, p2, p3, p4);
 }
 
 // If 1 point is on the boundary
@@ -486,16 +501,14 @@ bool is_point_inside_region(const Point_2 &point, const Polygon polygon)
 
 Point_2 find_obtuse_vertex_1(const Point_2 &v1, const Point_2 &v2, const Point_2 &v3)
 {
-    // Calculate squared distances
-    double ab2 = CGAL::to_double(squared_distance_1(v1, v2));
-    double ac2 = CGAL::to_double(squared_distance_1(v1, v3));
-    double bc2 = CGAL::to_double(squared_distance_1(v2, v3));
+    // Same filtered predicate as is_obtuse
+    int obtuse_index = obtuse_vertex_index(v1, v2, v3);
 
-    if (ab2 + ac2 < bc2)
+    if (obtuse_index == 0)
         return v1; // obtuse angle at v1
-    if (ab2 + bc2 < ac2)
+    if (obtuse_index == 1)
         return v2; // obtuse angle at v2
-    if (ac2 + bc2 < ab2)
+    if (obtuse_index == 2)
         return v3; // obtuse angle at v3
 
     throw std::logic_error("No obtuse angle found in the triangle.");
@@ -599,44 +612,45 @@ bool is_face_on_boundary(const Custom_CDT &cdt, Face_handle face)
                         { return p == v_point; });
 }*/
 
-void run_task1(Custom_CDT& custom_cdt, Polygon& polygon){
+void run_task1(Custom_CDT& custom_cdt, Polygon& polygon, const Deadline& deadline){
     int init_obtuses = count_obtuse_triangles_1(custom_cdt, polygon);
     cout<<"Initial number of obtuses: "<<init_obtuses<<endl;
     int end;
     //If we have progress (reduce obtuses) run again
     bool progress = true;
-    while(progress){
+    //Every step keeps only improvements, so when the deadline expires custom_cdt is the best so far
+    while(progress && !deadline.expired()){
         progress = false;
         int start = count_obtuse_triangles_1(custom_cdt, polygon);
         int num_obtuses_before = start;
         //Flips
         start_the_flips_1(custom_cdt, polygon);
         int num_obtuses_after = count_obtuse_triangles_1(custom_cdt, polygon);
-        if(num_obtuses_after == 0) break;
+        if(num_obtuses_after == 0 || deadline.expired()) break;
 
         //Circumcenter - Centroid
         num_obtuses_before = count_obtuse_triangles_1(custom_cdt, polygon);
         insert_circumcenter_centroid_1(custom_cdt, polygon);
         num_obtuses_after = count_obtuse_triangles_1(custom_cdt, polygon);
-        if(num_obtuses_after == 0) break;
+        if(num_obtuses_after == 0 || deadline.expired()) break;
 
         //Midpoint
         num_obtuses_before = count_obtuse_triangles_1(custom_cdt, polygon);
         insert_midpoint_1(custom_cdt, polygon);
         num_obtuses_after = count_obtuse_triangles_1(custom_cdt, polygon);
-        if(num_obtuses_after == 0) break;
+        if(num_obtuses_after == 0 || deadline.expired()) break;
 
         //Projection
         num_obtuses_before = count_obtuse_triangles_1(custom_cdt, polygon);
         insert_projection_1(custom_cdt, polygon);
         num_obtuses_after = count_obtuse_triangles_1(custom_cdt, polygon);
-        if(num_obtuses_after == 0) break;
+        if(num_obtuses_after == 0 || deadline.expired()) break;
         
         //Orthocenter
         num_obtuses_before = count_obtuse_triangles_1(custom_cdt, polygon);
         insert_orthocenter_1(custom_cdt, polygon);
         num_obtuses_after = count_obtuse_triangles_1(custom_cdt, polygon);
-        if(num_obtuses_after == 0) break;
+        if(num_obtuses_after == 0 || deadline.expired()) break;
         
         end = num_obtuses_after;
         if(end < start ) progress = true;
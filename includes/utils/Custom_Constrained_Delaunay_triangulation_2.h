@@ -4,11 +4,54 @@
 
 
 
+//First, it can replace the allocator of the CGAL containers
+#include "pool_allocator.h"
 #include <CGAL/Constrained_Delaunay_triangulation_2.h>
+#include <CGAL/Triangulation_data_structure_2.h>
+#include <CGAL/Triangulation_vertex_base_2.h>
+#include <CGAL/Triangulation_vertex_base_with_info_2.h>
+#include <CGAL/Constrained_triangulation_face_base_2.h>
+#include <CGAL/Triangulation_face_base_with_info_2.h>
+#include <CGAL/spatial_sort.h>
+#include <CGAL/Spatial_sort_traits_adapter_2.h>
+#include <CGAL/property_map.h>
+#include "obtuse_predicate.h"
+#include "phase_timers.h"
+#include <functional>
+#include <map>
+#include <numeric>
+#include <set>
+#include <utility>
+#include <vector>
+
+
+//Information that we keep in every face of the Custom CDT
+struct Custom_face_info {
+    //True if the face is finite and has an obtuse angle
+    bool obtuse = false;
+    //True if the face is inside of the region boundary (see mark_region)
+    bool in_region = false;
+    //Position of the face in the face container, set at the start of every run of the flip engine (see Flip_queue)
+    int flip_rank = 0;
+};
+
+//Information that we keep in every vertex of the Custom CDT
+struct Custom_vertex_info {
+    //Index of the point in the input (see insert_points), -1 for a steiner point (every vertex that the algorithms insert)
+    int input_index = -1;
+    //Index of a steiner point in the order of insertion (see steiner_vertices), -1 for an input point
+    int steiner_index = -1;
+};
 
+//Default data structure: vertex base with a Custom_vertex_info and constrained face base with a Custom_face_info in every face.
+//The info is copied together with the faces, so a copy of the cdt keeps the obtuse index and the region flags.
+template <class Gt>
+using Custom_tds_2 = CGAL::Triangulation_data_structure_2<
+    CGAL::Triangulation_vertex_base_with_info_2<Custom_vertex_info, Gt>,
+    CGAL::Triangulation_face_base_with_info_2<Custom_face_info, Gt, CGAL::Constrained_triangulation_face_base_2<Gt>>>;
 
 
-template <class Gt, class Tds = CGAL::Default, class Itag = CGAL::Default>
+template <class Gt, class Tds = Custom_tds_2<Gt>, class Itag = CGAL::Default>
 
 class Custom_Constrained_Delaunay_triangulation_2
 
@@ -18,7 +61,7 @@ public:
 
     using Base = CGAL::Constrained_Delaunay_triangulation_2<Gt, Tds, Itag>;
 
-    
+
 
     using typename Base::Face_handle;
 
@@ -28,7 +71,18 @@ public:
 
     using typename Base::Locate_type;
 
-    
+    using typename Base::Face_circulator;
+
+    using typename Base::Edge;
+
+    //No using Base::insert or Base::insert_constraint: the insertions of the base class would skip the obtuse index,
+    //the transactions and the flip state. insert(), insert_no_flip(), insert_points(), insert_constraint(a, b) and
+    //insert_constraints() are the only ones
+
+    //Set of faces with its nodes from the block pool
+    using Face_set = std::set<Face_handle, std::less<Face_handle>, Pool_allocator<Face_handle>>;
+
+
     //using CGAL::Delaunay_triangulation_2<Gt, Tds>::nearest_vertex;
 
     // Constructors
@@ -41,7 +95,7 @@ public:
 
     Custom_Constrained_Delaunay_triangulation_2(typename Base::List_constraints& lc, const Gt& gt = Gt())
 
-        : Base(lc, gt) {}
+        : Base(lc, gt), obtuse_flags_valid(false) {}
 
 
 
@@ -49,19 +103,51 @@ public:
 
     Custom_Constrained_Delaunay_triangulation_2(InputIterator it, InputIterator last, const Gt& gt = Gt())
 
-        : Base(it, last, gt) {}
+        : Base(it, last, gt), obtuse_flags_valid(false) {}
 
 
+    //The obtuse flags and the steiner indices are copied with the faces and the vertices, only the containers of
+    //handles have to be rebuilt. An open transaction of other is not copied (its log refers to the faces of other).
+    Custom_Constrained_Delaunay_triangulation_2(const Custom_Constrained_Delaunay_triangulation_2& other)
 
-    // New insert method without flips
+        : Base(other), obtuse_count(other.obtuse_count), region_obtuse_count(other.region_obtuse_count),
+          obtuse_flags_valid(other.obtuse_flags_valid), obtuse_set_valid(false),
+          snap_den(other.snap_den), flip_state(copied_flip_state(other.flip_state)) {
+        INSTRUMENT_COUNT(COUNTER_CDT_COPIES);
+        collect_steiner_vertices(other.steiner_list.size());
+    }
 
-    Vertex_handle insert_no_flip(const Point& a, Face_handle start = Face_handle()) {
 
-        // Call Ctr::insert without flip_around
+    Custom_Constrained_Delaunay_triangulation_2& operator=(const Custom_Constrained_Delaunay_triangulation_2& other) {
+        if (this == &other) return *this;
+        INSTRUMENT_COUNT(COUNTER_CDT_COPIES);
+        Base::operator=(other);
+        obtuse_count = other.obtuse_count;
+        region_obtuse_count = other.region_obtuse_count;
+        obtuse_flags_valid = other.obtuse_flags_valid;
+        obtuse_set_valid = false;
+        snap_den = other.snap_den;
+        flip_state = copied_flip_state(other.flip_state);
+        obtuse_set.clear();
+        collect_steiner_vertices(other.steiner_list.size());
+        transaction_log.clear();
+        transaction_marks.clear();
+        flip_state_marks.clear();
+        return *this;
+    }
 
-        Vertex_handle va = this->Base::Ctr::insert(a, start); // Directly call Ctr::insert from the base
 
-        return va;
+
+    // New insert method without flips
+
+    Vertex_handle insert_no_flip(const Point& a, Face_handle start = Face_handle()) {
+        Phase_timer timer(PHASE_INSERTION);
+
+        // Same location step as Ctr::insert(a, start)
+        Locate_type lt;
+        int li;
+        Face_handle loc = this->locate(a, lt, li, start);
+        return insert_no_flip(a, lt, loc, li);
 
     }
     /*void remove_no_flip(Vertex_handle v) {
@@ -73,16 +159,649 @@ public:
      void remove_constraint_no_flip(Face_handle f, int i){
         this->Base::Ctr::remove_constrained_edge(f, i);
     }*/
-    
+
     // Another insert method with known location
 
+    //Inside a transaction only points in a face or on an edge are inserted (they can be undone locally).
+    //Points outside of the convex hull are rejected and the returned handle is null.
     Vertex_handle insert_no_flip(const Point& a, Locate_type lt, Face_handle loc, int li) {
+        Phase_timer timer(PHASE_INSERTION);
+        INSTRUMENT_COUNT(COUNTER_INSERT_NO_FLIP);
+        int dimension_before = this->dimension();
+
+        //Point already in the cdt, nothing changes
+        if (lt == Base::VERTEX) return this->Base::Ctr::insert(a, lt, loc, li);
+
+        Transaction_step step;
+        if (in_transaction()) {
+            if (dimension_before < 2 || (lt != Base::FACE && lt != Base::EDGE)) return Vertex_handle();
+            //The located face (and its neighbor for an edge) are the only faces that the insertion modifies
+            step.records[step.number_of_records++] = make_record(loc);
+            if (lt == Base::EDGE) step.records[step.number_of_records++] = make_record(loc->neighbor(li));
+        }
+        if (face_removed && dimension_before == 2 && (lt == Base::FACE || lt == Base::EDGE)) {
+            face_removed(loc);
+            if (lt == Base::EDGE) face_removed(loc->neighbor(li));
+        }
+
+        //Region flags of the split face, or of the two sides of the split edge
+        bool in_region = false, other_in_region = false;
+        Vertex_handle opposite;
+        if (dimension_before == 2 && (lt == Base::FACE || lt == Base::EDGE)) {
+            in_region = loc->info().in_region;
+            if (lt == Base::EDGE) {
+                opposite = loc->vertex(li);
+                other_in_region = loc->neighbor(li)->info().in_region;
+            }
+        }
 
         Vertex_handle va = this->Base::Ctr::insert(a, lt, loc, li); // Directly call Ctr::insert from the base
+        add_steiner_vertex(va);
+
+        if (in_transaction()) {
+            step.vertex = va;
+            transaction_log.push_back(step);
+        }
+        //A settled cdt stays settled except around the first new vertex (see flip_until_stable)
+        if (dimension_before == 2 && (lt == Base::FACE || lt == Base::EDGE) && flip_state.pending_vertex == Vertex_handle()) {
+            flip_state.pending_vertex = va;
+        }
+        else flip_state = Flip_state();
+        //Without flips, every face that changed is incident to the new vertex
+        if (dimension_before == 2) {
+            //The new faces are inside the face (or on the side of the edge) that they split.
+            //Faces outside of the convex hull are outside of the region.
+            Face_circulator face = this->incident_faces(va), done(face);
+            do {
+                if (lt == Base::EDGE && !face->has_vertex(opposite)) set_region_flag(face, other_in_region);
+                else set_region_flag(face, in_region);
+            } while (++face != done);
+            update_obtuse_star(va);
+            if (face_added) {
+                Face_circulator face = this->incident_faces(va), done(face);
+                do {
+                    face_added(face);
+                } while (++face != done);
+            }
+        }
+        else invalidate_obtuse_index();
 
         return va;
 
     }
+
+    //Flip of the edge (f, i) that keeps the obtuse index up to date. Only f and its neighbor change.
+    //The edge is not constrained, so f and its neighbor are on the same side of the region boundary and keep their region flags.
+    void flip(Face_handle& f, int i) {
+        Face_handle g = f->neighbor(i);
+        if (in_transaction()) {
+            Transaction_step step;
+            step.records[step.number_of_records++] = make_record(f);
+            step.records[step.number_of_records++] = make_record(g);
+            transaction_log.push_back(step);
+        }
+        if (face_removed) {
+            face_removed(f);
+            face_removed(g);
+        }
+        Base::flip(f, i);
+        flip_state = Flip_state();
+        update_obtuse_flag(f);
+        update_obtuse_flag(g);
+        if (face_added) {
+            face_added(f);
+            face_added(g);
+        }
+    }
+
+    /*Face observers*/
+    //removed(f) is called with every face that an insertion or a flip is about to change (f still has its old
+    //vertices), added(f) with every face after the change. Insertions outside of the convex hull only report
+    //the new faces. Rollbacks are not reported and copies of the cdt don't take the observers.
+    void set_face_observers(std::function<void(Face_handle)> removed, std::function<void(Face_handle)> added) {
+        face_removed = removed;
+        face_added = added;
+    }
+
+    void clear_face_observers() {
+        face_removed = nullptr;
+        face_added = nullptr;
+    }
+
+    /*Snapping of the steiner points*/
+    //Denominator of the snapped coordinates of the steiner points that the algorithms construct for this cdt
+    //(see steiner_snapping.h), <= 0 for exact constructions. It is copied with the cdt.
+    void set_snap_denominator(long denominator) {
+        snap_den = denominator;
+    }
+
+    long snap_denominator() const {
+        return snap_den;
+    }
+
+    //Insertion with the Delaunay flips of the base class, done with insert_no_flip and flip
+    //so that the obtuse index stays valid and the insertion can be part of a transaction
+    Vertex_handle insert(const Point& a, Face_handle start = Face_handle()) {
+        Phase_timer timer(PHASE_INSERTION);
+        if (this->dimension() < 2 && !in_transaction()) {
+            Vertex_handle va = Base::insert(a, start);
+            //A new vertex has no index yet (the point can be a vertex already)
+            if (va->info().input_index < 0 && va->info().steiner_index < 0) add_steiner_vertex(va);
+            invalidate_obtuse_index();
+            flip_state = Flip_state();
+            return va;
+        }
+        Vertex_handle va = insert_no_flip(a, start);
+        if (va != Vertex_handle() && this->dimension() == 2) delaunay_flip_around(va);
+        return va;
+    }
+
+    /*Transactions*/
+    //Every insert_no_flip, insert and flip after begin_transaction() is logged with the faces it modified,
+    //so rollback_transaction() restores the cdt by touching only those faces. Transactions can be nested.
+    //Face handles of the cdt that were valid at begin_transaction() are valid (and the same faces) after a rollback.
+    void begin_transaction() {
+        //The records keep the obtuse flags of the faces and a rollback counts them back, so the flags must be valid
+        //before the first step (the steps of a transaction keep them valid)
+        if (!obtuse_flags_valid) rebuild_obtuse_index();
+        transaction_marks.push_back(transaction_log.size());
+        flip_state_marks.push_back(flip_state);
+    }
+
+    //Keep the changes of the innermost transaction
+    void commit_transaction() {
+        transaction_marks.pop_back();
+        flip_state_marks.pop_back();
+        if (transaction_marks.empty()) transaction_log.clear();
+    }
+
+    //Undo the changes of the innermost transaction
+    void rollback_transaction() {
+        std::size_t mark = transaction_marks.back();
+        transaction_marks.pop_back();
+        while (transaction_log.size() > mark) {
+            undo_step(transaction_log.back());
+            transaction_log.pop_back();
+        }
+        flip_state = flip_state_marks.back();
+        flip_state_marks.pop_back();
+    }
+
+    bool in_transaction() const {
+        return !transaction_marks.empty();
+    }
+
+    /*Snapshots*/
+    //A snapshot is a transaction that stays open at a saved state of the cdt (the best triangulation of a search).
+    //save_snapshot() makes the current state the saved one and restore_snapshot() goes back to it, both in time
+    //proportional to the changes since the snapshot (not to the size of the cdt). Other transactions can be nested inside.
+    void begin_snapshot() {
+        begin_transaction();
+    }
+
+    void save_snapshot() {
+        commit_transaction();
+        begin_transaction();
+    }
+
+    void restore_snapshot() {
+        rollback_transaction();
+        begin_transaction();
+    }
+
+    //Go back to the saved state and close the snapshot
+    void end_snapshot() {
+        rollback_transaction();
+    }
+
+    /*Flip engine*/
+    //Flip the edges (f, i) for which should_flip(f, i) is true, until there is no such edge.
+    //Every flip is the one of a scan that flips the first flippable edge of finite_edges and starts again, so the
+    //stable triangulation is the same: the candidate edges wait in a queue ordered by their position in finite_edges
+    //and after a flip only the edges of the two new faces are checked again (bench_triangulation --compare-flips).
+    //The result of should_flip must depend only on the two faces of the edge: the type Flip_test names the criterion
+    //for which the cdt is settled after the run. Returns the number of flips.
+    template <class Flip_test>
+    int flip_until_stable(Flip_test should_flip) {
+        if (this->dimension() < 2) return 0;
+        Flip_queue queue(*this);
+        for (auto edge = this->finite_edges_begin(); edge != this->finite_edges_end(); ++edge) {
+            queue.push(edge->first, edge->second);
+        }
+        return run_flip_queue(queue, should_flip);
+    }
+
+    //Same after the insertion of va. If the cdt was settled for Flip_test and insert_no_flip(va) is its only change
+    //since then, only the faces around va changed: they have the spokes of va and the opposite edges, so only them
+    //are seeded (the positions of the faces are still set by a pass over all the faces, without predicates).
+    //Otherwise (f.e. an insert with Delaunay flips or two insertions) all the edges are seeded.
+    template <class Flip_test>
+    int flip_until_stable(Flip_test should_flip, Vertex_handle va) {
+        if (va == Vertex_handle() || this->dimension() < 2) return 0;
+        bool settled = flip_state.settled_test == flip_test_key<Flip_test>();
+        //va was already a vertex (insert_no_flip changed nothing)
+        if (settled && flip_state.pending_vertex == Vertex_handle()) return 0;
+        if (!settled || flip_state.pending_vertex != va) return flip_until_stable(should_flip);
+        Flip_queue queue(*this);
+        Face_circulator face = this->incident_faces(va), done(face);
+        do {
+            int i = face->index(va);
+            queue.push(face, i);
+            queue.push(face, this->ccw(i));
+        } while (++face != done);
+        return run_flip_queue(queue, should_flip);
+    }
+
+    //The points that are not vertices yet are inserted as steiner points
+    void insert_constraint(const Point& a, const Point& b) {
+        Vertex_handle va = insert(a);
+        Vertex_handle vb = insert(b, va->face());
+        insert_constraint(va, vb);
+    }
+
+    void insert_constraint(Vertex_handle va, Vertex_handle vb) {
+        Base::insert_constraint(va, vb);
+        invalidate_obtuse_index();
+        flip_state = Flip_state();
+    }
+
+    /*Bulk construction*/
+    //Insert the points in spatial (Hilbert) order, each one located from the vertex before it, and return the vertex of
+    //every point (in the order of points). The points are the input: every vertex gets the index of its point (the last
+    //one for equal points). The obtuse index is rebuilt once, when it is needed.
+    std::vector<Vertex_handle> insert_points(const std::vector<Point>& points) {
+        typedef CGAL::Spatial_sort_traits_adapter_2<Gt, typename CGAL::Pointer_property_map<Point>::const_type> Sort_traits;
+        std::vector<std::size_t> order(points.size());
+        std::iota(order.begin(), order.end(), 0);
+        CGAL::spatial_sort(order.begin(), order.end(), Sort_traits(CGAL::make_property_map(points)));
+
+        std::vector<Vertex_handle> vertices(points.size());
+        Face_handle hint;
+        for (std::size_t i : order) {
+            vertices[i] = Base::insert(points[i], hint);
+            hint = vertices[i]->face();
+        }
+        for (std::size_t i = 0; i < points.size(); ++i) vertices[i]->info().input_index = static_cast<int>(i);
+        invalidate_obtuse_index();
+        flip_state = Flip_state();
+        return vertices;
+    }
+
+    //Insert the constraints (pairs of indices into vertices) as one batch
+    void insert_constraints(const std::vector<Vertex_handle>& vertices, const std::vector<std::pair<int, int>>& constraints) {
+        for (const auto& constraint : constraints) {
+            Base::insert_constraint(vertices[constraint.first], vertices[constraint.second]);
+        }
+        invalidate_obtuse_index();
+        flip_state = Flip_state();
+    }
+
+    /*Region flags*/
+    //Mark the faces inside of the region. Walks the faces from the infinite face and changes side when it crosses
+    //a constrained edge (f, i) with is_region_edge(f, i) true, so the region boundary must be constraints of the cdt.
+    //Call it after the constraints are inserted, later insertions and flips keep the flags.
+    template <class Region_edge_test>
+    void mark_region(Region_edge_test is_region_edge) {
+        for (auto face = this->all_faces_begin(); face != this->all_faces_end(); ++face) set_region_flag(face, false);
+        flip_state = Flip_state();
+        if (this->dimension() < 2) return;
+
+        Face_set visited;
+        std::vector<Face_handle> stack;
+        visited.insert(this->infinite_face());
+        stack.push_back(this->infinite_face());
+        while (!stack.empty()) {
+            Face_handle face = stack.back();
+            stack.pop_back();
+            for (int i = 0; i < 3; ++i) {
+                Face_handle neighbor = face->neighbor(i);
+                if (visited.count(neighbor) > 0) continue;
+                bool crosses = face->is_constrained(i) && is_region_edge(face, i);
+                set_region_flag(neighbor, face->info().in_region != crosses);
+                visited.insert(neighbor);
+                stack.push_back(neighbor);
+            }
+        }
+    }
+
+    //O(1) region test of a face of this cdt
+    bool is_in_region(Face_handle face) const {
+        return face->info().in_region;
+    }
+
+    /*Obtuse index*/
+    //Number of finite obtuse faces of the cdt
+    int number_of_obtuse_faces() {
+        if (!obtuse_flags_valid) rebuild_obtuse_index();
+        return obtuse_count;
+    }
+
+    //Number of finite obtuse faces inside of the region (see mark_region)
+    int number_of_obtuse_faces_in_region() {
+        if (!obtuse_flags_valid) rebuild_obtuse_index();
+        return region_obtuse_count;
+    }
+
+    //All the finite obtuse faces of the cdt
+    const Face_set& obtuse_faces() {
+        if (!obtuse_flags_valid) rebuild_obtuse_index();
+        if (!obtuse_set_valid) {
+            obtuse_set.clear();
+            for (auto face = this->finite_faces_begin(); face != this->finite_faces_end(); ++face) {
+                if (face->info().obtuse) obtuse_set.insert(face);
+            }
+            obtuse_set_valid = true;
+        }
+        return obtuse_set;
+    }
+
+    //O(1) obtuse test of a face of this cdt
+    bool is_obtuse_face(Face_handle face) {
+        if (!obtuse_flags_valid) rebuild_obtuse_index();
+        return face->info().obtuse;
+    }
+
+    /*Steiner points*/
+    //The vertices that insert_no_flip and insert added, by steiner_index. A rollback takes its vertices out again,
+    //so the indices are always 0 to the number of steiner points - 1
+    const std::vector<Vertex_handle>& steiner_vertices() const {
+        return steiner_list;
+    }
+
+    //Force a full recount on the next query (used after operations that bypass the index)
+    void invalidate_obtuse_index() {
+        obtuse_flags_valid = false;
+        obtuse_set_valid = false;
+    }
+
+private:
+    //The criterion (flip_test_key of a Flip_test) for which no edge was flippable at the end of the last flip_until_stable,
+    //null if the cdt changed after it by more than one insert_no_flip (pending_vertex)
+    struct Flip_state {
+        const void* settled_test = nullptr;
+        Vertex_handle pending_vertex;
+    };
+
+    //One address for every type of criterion
+    template <class Flip_test>
+    static const void* flip_test_key() {
+        static const char key = 0;
+        return &key;
+    }
+
+    //The pending vertex is a handle of the other cdt, so a copy is settled only without it
+    static Flip_state copied_flip_state(const Flip_state& state) {
+        return state.pending_vertex == Vertex_handle() ? state : Flip_state();
+    }
+
+    //Candidate edges of the flip engine, by their position in finite_edges. The edge iterator goes over the faces in the
+    //order of the face container and gives (f, i) for i = 0, 1, 2 when f is the smaller handle of the two faces, so
+    //the position is (flip_rank of that face, i). A flip reuses its two faces and the other faces keep their
+    //place, so during a run the position of every edge that the flip did not touch stays the same.
+    struct Flip_queue {
+        using Position = std::pair<int, int>;
+        Custom_Constrained_Delaunay_triangulation_2& cdt;
+        std::map<Position, Face_handle, std::less<Position>, Pool_allocator<std::pair<const Position, Face_handle>>> edges;
+
+        explicit Flip_queue(Custom_Constrained_Delaunay_triangulation_2& in_cdt) : cdt(in_cdt) {
+            int rank = 0;
+            for (auto face = cdt.all_faces_begin(); face != cdt.all_faces_end(); ++face) face->info().flip_rank = rank++;
+        }
+
+        //The face and the index that finite_edges gives for the edge (f, i)
+        void first_side(Face_handle& f, int& i) const {
+            Face_handle g = f->neighbor(i);
+            if (std::less<Face_handle>()(g, f)) {
+                i = g->index(f);
+                f = g;
+            }
+        }
+
+        void push(Face_handle f, int i) {
+            if (cdt.is_infinite(f, i)) return;
+            first_side(f, i);
+            edges.emplace(Position(f->info().flip_rank, i), f);
+        }
+
+        void erase(Face_handle f, int i) {
+            first_side(f, i);
+            edges.erase(Position(f->info().flip_rank, i));
+        }
+    };
+
+    template <class Flip_test>
+    int run_flip_queue(Flip_queue& queue, Flip_test& should_flip) {
+        int flips = 0;
+        while (!queue.edges.empty()) {
+            Face_handle f = queue.edges.begin()->second;
+            int i = queue.edges.begin()->first.second;
+            queue.edges.erase(queue.edges.begin());
+            INSTRUMENT_COUNT(COUNTER_FLIP_EDGES_SCANNED);
+            //An edge out of the queue is not flippable, so the first flippable edge of the queue is the first one of finite_edges
+            if (!should_flip(f, i)) continue;
+
+            //The five edges of the quad change their faces (and their position), the queue keeps the new positions
+            Face_handle g = f->neighbor(i);
+            for (int k = 0; k < 3; ++k) {
+                queue.erase(f, k);
+                queue.erase(g, k);
+            }
+            flip(f, i);
+            flips++;
+            INSTRUMENT_COUNT(COUNTER_FLIPS);
+            //f and g are the two faces of the new diagonal, check again the sides of the quad and the new diagonal
+            for (int k = 0; k < 3; ++k) {
+                queue.push(f, k);
+                queue.push(g, k);
+            }
+        }
+        //No queued edge is flippable and the edges out of the queue did not change since their test
+        flip_state.settled_test = flip_test_key<Flip_test>();
+        flip_state.pending_vertex = Vertex_handle();
+        return flips;
+    }
+
+    //State of a face before a logged step modified it
+    struct Face_record {
+        Face_handle face;
+        Vertex_handle vertices[3];
+        Face_handle neighbors[3];
+        Face_handle vertex_faces[3];
+        bool constrained[3];
+        Custom_face_info info;
+    };
+
+    //One insertion (vertex != null) or one flip, with the faces that it modified
+    struct Transaction_step {
+        Vertex_handle vertex;
+        Face_record records[2];
+        int number_of_records = 0;
+    };
+
+    int obtuse_count = 0;
+    //Obtuse faces with the region flag
+    int region_obtuse_count = 0;
+    bool obtuse_flags_valid = true;
+    bool obtuse_set_valid = true;
+    long snap_den = 0;
+    Face_set obtuse_set;
+    std::vector<Vertex_handle> steiner_list;
+    std::vector<Transaction_step> transaction_log;
+    std::vector<std::size_t> transaction_marks;
+    //flip_state at every begin_transaction, a rollback gives it back
+    std::vector<Flip_state> flip_state_marks;
+    Flip_state flip_state;
+    std::function<void(Face_handle)> face_removed, face_added;
+
+    Face_record make_record(Face_handle face) const {
+        Face_record record;
+        record.face = face;
+        for (int i = 0; i < 3; ++i) {
+            record.vertices[i] = face->vertex(i);
+            record.neighbors[i] = face->neighbor(i);
+            record.vertex_faces[i] = face->vertex(i)->face();
+            record.constrained[i] = face->is_constrained(i);
+        }
+        record.info = face->info();
+        return record;
+    }
+
+    bool is_recorded(const Transaction_step& step, Face_handle face) const {
+        for (int r = 0; r < step.number_of_records; ++r) {
+            if (step.records[r].face == face) return true;
+        }
+        return false;
+    }
+
+    //Put the recorded faces back, delete the faces and the vertex that the step created
+    void undo_step(const Transaction_step& step) {
+        //The created faces are the faces around the new vertex that were not recorded
+        std::vector<Face_handle> created_faces;
+        if (step.vertex != Vertex_handle()) {
+            Face_circulator face = this->incident_faces(step.vertex), done(face);
+            do {
+                if (!is_recorded(step, face)) created_faces.push_back(face);
+            } while (++face != done);
+        }
+        for (const Face_handle& face : created_faces) remove_obtuse_flag(face);
+        for (int r = 0; r < step.number_of_records; ++r) remove_obtuse_flag(step.records[r].face);
+
+        for (int r = 0; r < step.number_of_records; ++r) {
+            const Face_record& record = step.records[r];
+            record.face->set_vertices(record.vertices[0], record.vertices[1], record.vertices[2]);
+            record.face->set_neighbors(record.neighbors[0], record.neighbors[1], record.neighbors[2]);
+            for (int i = 0; i < 3; ++i) record.face->set_constraint(i, record.constrained[i]);
+            record.face->info() = record.info;
+        }
+        //The neighbors outside of the step point again to the recorded faces
+        for (int r = 0; r < step.number_of_records; ++r) {
+            const Face_record& record = step.records[r];
+            for (int i = 0; i < 3; ++i) {
+                Face_handle neighbor = record.neighbors[i];
+                if (is_recorded(step, neighbor)) continue;
+                int j = 3 - neighbor->index(record.vertices[this->ccw(i)]) - neighbor->index(record.vertices[this->cw(i)]);
+                neighbor->set_neighbor(j, record.face);
+            }
+            for (int i = 0; i < 3; ++i) record.vertices[i]->set_face(record.vertex_faces[i]);
+        }
+        //Reverse order of creation, so the free slots are reused as before
+        for (auto face = created_faces.rbegin(); face != created_faces.rend(); ++face) this->_tds.delete_face(*face);
+        if (step.vertex != Vertex_handle()) {
+            //The steps are undone in the reverse order, so the vertex is the last steiner point
+            steiner_list.pop_back();
+            this->_tds.delete_vertex(step.vertex);
+        }
+
+        for (int r = 0; r < step.number_of_records; ++r) add_obtuse_flag(step.records[r].face);
+    }
+
+    //Delaunay flips around a new vertex, same order as Constrained_Delaunay_triangulation_2::flip_around
+    //(propagating_flip without recursion: a face is kept in the stack together with the new vertex)
+    void delaunay_flip_around(Vertex_handle va) {
+        Face_handle face = va->face(), start = face, next;
+        std::vector<Face_handle> stack;
+        do {
+            next = face->neighbor(this->ccw(face->index(va)));
+            stack.push_back(face);
+            while (!stack.empty()) {
+                Face_handle f = stack.back();
+                stack.pop_back();
+                int i = f->index(va);
+                if (!this->is_flipable(f, i)) continue;
+                Face_handle neighbor = f->neighbor(i);
+                flip(f, i);
+                stack.push_back(neighbor);
+                stack.push_back(f);
+            }
+            face = next;
+        } while (next != start);
+    }
+
+    void add_steiner_vertex(Vertex_handle va) {
+        va->info().steiner_index = static_cast<int>(steiner_list.size());
+        steiner_list.push_back(va);
+    }
+
+    //The steiner vertices of a copy, from the indices of its vertices
+    void collect_steiner_vertices(std::size_t number_of_steiners) {
+        steiner_list.assign(number_of_steiners, Vertex_handle());
+        for (auto vertex = this->finite_vertices_begin(); vertex != this->finite_vertices_end(); ++vertex) {
+            if (vertex->info().steiner_index >= 0) steiner_list[vertex->info().steiner_index] = vertex;
+        }
+    }
+
+    //Counter and set without the face, the flag itself is left as it is
+    void remove_obtuse_flag(Face_handle face) {
+        if (!obtuse_flags_valid || !face->info().obtuse) return;
+        obtuse_count--;
+        if (face->info().in_region) region_obtuse_count--;
+        if (obtuse_set_valid) obtuse_set.erase(face);
+    }
+
+    //Counter and set with the (restored) flag of the face
+    void add_obtuse_flag(Face_handle face) {
+        if (!obtuse_flags_valid || !face->info().obtuse) return;
+        obtuse_count++;
+        if (face->info().in_region) region_obtuse_count++;
+        if (obtuse_set_valid) obtuse_set.insert(face);
+    }
+
+    static bool has_obtuse_angle(Face_handle face) {
+        const Point& a = face->vertex(0)->point();
+        const Point& b = face->vertex(1)->point();
+        const Point& c = face->vertex(2)->point();
+        return obtuse_vertex_index(a, b, c) >= 0;
+    }
+
+    //Recompute the flag of one face and update the counter and the set
+    void update_obtuse_flag(Face_handle face) {
+        if (!obtuse_flags_valid) return;
+        bool obtuse = !this->is_infinite(face) && has_obtuse_angle(face);
+        if (face->info().obtuse == obtuse) return;
+        face->info().obtuse = obtuse;
+        if (obtuse) {
+            obtuse_count++;
+            if (face->info().in_region) region_obtuse_count++;
+            if (obtuse_set_valid) obtuse_set.insert(face);
+        }
+        else {
+            obtuse_count--;
+            if (face->info().in_region) region_obtuse_count--;
+            if (obtuse_set_valid) obtuse_set.erase(face);
+        }
+    }
+
+    //Region flag of one face, the counter of the obtuse faces in the region follows it
+    void set_region_flag(Face_handle face, bool in_region) {
+        if (obtuse_flags_valid && face->info().obtuse && face->info().in_region != in_region) {
+            region_obtuse_count += in_region ? 1 : -1;
+        }
+        face->info().in_region = in_region;
+    }
+
+    //Faces created (or reused) by an insertion are exactly the faces around the new vertex
+    void update_obtuse_star(Vertex_handle va) {
+        Face_circulator face = this->incident_faces(va), done(face);
+        do {
+            update_obtuse_flag(face);
+        } while (++face != done);
+    }
+
+    void rebuild_obtuse_index() {
+        obtuse_count = 0;
+        region_obtuse_count = 0;
+        obtuse_set.clear();
+        for (auto face = this->all_faces_begin(); face != this->all_faces_end(); ++face) {
+            face->info().obtuse = !this->is_infinite(face) && has_obtuse_angle(face);
+            if (face->info().obtuse) {
+                obtuse_count++;
+                if (face->info().in_region) region_obtuse_count++;
+                obtuse_set.insert(face);
+            }
+        }
+        obtuse_flags_valid = true;
+        obtuse_set_valid = true;
+    }
 };
 
 
@@ -11,24 +11,42 @@ using Point_2 = K::Point_2;
 using Face_handle = Custom_CDT::Face_handle;
 using Segment_2 = K::Segment_2;
 
+//A face identified by its three vertices, so that it can be compared across copies of a cdt.
+//Copies of a cdt share the representations of the points (Epeck points are handles), so the id of the
+//point of a vertex is the same in best_cdt and in the cdt of every ant. The ids are sorted.
+using Face_key = std::array<std::ptrdiff_t, 3>;
+
+struct Face_key_hash {
+    std::size_t operator()(const Face_key& key) const {
+        std::size_t seed = 0;
+        for (std::ptrdiff_t id : key) seed ^= std::hash<std::ptrdiff_t>()(id) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        return seed;
+    }
+};
+
+using Face_key_set = std::unordered_set<Face_key, Face_key_hash, std::equal_to<Face_key>, Pool_allocator<Face_key>>;
+
+inline Face_key face_key(const Face_handle& face) {
+    Face_key key = {face->vertex(0)->point().id(), face->vertex(1)->point().id(), face->vertex(2)->point().id()};
+    std::sort(key.begin(), key.end());
+    return key;
+}
 
 
+//The move of an ant in a cycle: the method, the steiner point, the energy that it gives and the faces of best_cdt that it changes.
+//The ant has no triangulation of its own, the move is simulated (and taken back) on a replica of best_cdt.
 class Ant {
 public:
     //Constructor without arguments
     Ant();  
-    //With explicit accept and: Ant ant1 = cdt;
-    explicit Ant(const Custom_CDT& initial_cdt);
-    Ant(const Ant& other_ant);
     void set_steiner(const Point_2& in_ant_steiner_point);
-    void set_face_in_ant_affect_faces(const Face_handle& face);
+    void set_affected_faces(Face_key_set in_affected_faces);
     void set_steiner_method(SteinerMethod in_method);
     void set_energy(double in_energy);
-    void set_Custom_CDT(Custom_CDT& new_cdt);
     void set_DeltaE(double in_DeltaE);
     void set_conflict(bool in_conflict);
     //Static because we want to call it without an instance of Ant
-    static void initialize_Ants(vector<Ant>& ants, Custom_CDT& best_cdt);
+    static void initialize_Ants(vector<Ant>& ants);
     void set_reduce_obtuses(bool in_ant_reduce_obtuses);
     void set_num_of_obtuses(const int in_num_of_obtuses);
     void set_longest_edge_midpoint(Segment_2 in_longest_edge);
@@ -36,9 +54,8 @@ public:
 
 
     void clear_ant_affect_faces();
-    std::set<Face_handle>& get_affected_faces();
+    const Face_key_set& get_affected_faces() const;
     SteinerMethod get_steiner_method() const;
-    Custom_CDT& get_Custom_CDT();
     const Point_2& get_steiner_point() const;
     bool get_reduce_obtuses();
     bool get_conflict() const;
@@ -49,9 +66,9 @@ public:
     Segment_2 get_opposite_edge_projection() const;
 
 private:
-    std::set<Face_handle> ant_affect_faces;
+    //The faces of the initial cdt that the steiner of the ant destroyed (by the insertion or by the flips)
+    Face_key_set ant_affect_faces;
     SteinerMethod ant_steiner_method;
-    Custom_CDT ant_cdt;
     Point_2 ant_steiner_point;
     //Midpoint edge: We need this edge to check if the steiner was entered on the boundary
     Segment_2 longest_edge;
@@ -0,0 +1,111 @@
+//buffered_writer.h
+#ifndef BUFFERED_WRITER_H
+#define BUFFERED_WRITER_H
+
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+
+//Writes to a file descriptor through a fixed buffer, so a large file is written in big blocks without being built in memory.
+//After an error the writes are ignored and failed() is true.
+class Buffered_writer {
+public:
+    explicit Buffered_writer(const std::string& path) : owns_fd(true), used(0) {
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        error = (fd < 0);
+    }
+
+    //An open descriptor (a socket), close() writes the buffer but leaves the descriptor open
+    explicit Buffered_writer(int in_fd) : fd(in_fd), owns_fd(false), error(in_fd < 0), used(0) {}
+
+    ~Buffered_writer() {
+        close();
+    }
+
+    Buffered_writer(const Buffered_writer&) = delete;
+    Buffered_writer& operator=(const Buffered_writer&) = delete;
+
+    bool failed() const {
+        return error;
+    }
+
+    Buffered_writer& operator<<(const char* text) {
+        append(text, std::strlen(text));
+        return *this;
+    }
+
+    Buffered_writer& operator<<(const std::string& text) {
+        append(text.data(), text.size());
+        return *this;
+    }
+
+    Buffered_writer& operator<<(char c) {
+        append(&c, 1);
+        return *this;
+    }
+
+    Buffered_writer& operator<<(long long number) {
+        char digits[24];
+        char* end = std::to_chars(digits, digits + sizeof(digits), number).ptr;
+        append(digits, end - digits);
+        return *this;
+    }
+
+    Buffered_writer& operator<<(int number) {
+        return *this << static_cast<long long>(number);
+    }
+
+    //Write the rest of the buffer and close the file, false if something was not written
+    bool close() {
+        if (fd >= 0) {
+            flush();
+            if (owns_fd && ::close(fd) != 0) error = true;
+            fd = -1;
+        }
+        return !error;
+    }
+
+private:
+    void append(const char* data, std::size_t size) {
+        if (error) return;
+        if (used + size > sizeof(buffer)) {
+            flush();
+            //Larger than the buffer, write it directly
+            if (size > sizeof(buffer)) {
+                write_all(data, size);
+                return;
+            }
+        }
+        std::memcpy(buffer + used, data, size);
+        used += size;
+    }
+
+    void flush() {
+        write_all(buffer, used);
+        used = 0;
+    }
+
+    void write_all(const char* data, std::size_t size) {
+        while (!error && size > 0) {
+            ssize_t written = ::write(fd, data, size);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                error = true;
+                return;
+            }
+            data += written;
+            size -= written;
+        }
+    }
+
+    int fd;
+    bool owns_fd;
+    bool error;
+    char buffer[1 << 16];
+    std::size_t used;
+};
+
+#endif
@@ -0,0 +1,26 @@
+//deadline.h
+#ifndef DEADLINE_H
+#define DEADLINE_H
+
+#include <chrono>
+
+//Wall clock deadline of a run. The algorithms check it between their steps and return the best triangulation so far.
+//A default Deadline (or a time limit <= 0) never expires.
+class Deadline {
+public:
+    Deadline() : limited(false) {}
+
+    explicit Deadline(double seconds) : limited(seconds > 0) {
+        if (limited) end = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+    }
+
+    bool expired() const {
+        return limited && std::chrono::steady_clock::now() >= end;
+    }
+
+private:
+    bool limited;
+    std::chrono::steady_clock::time_point end;
+};
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef EXTRA_GRAPHICS_H
 #define EXTRA_GRAPHICS_H
 
+#include "functions.h"
+
 #include <QtWidgets/QApplication>
 #include <QtWidgets/QGraphicsView>
 #include <QtWidgets/QGraphicsScene>
@@ -10,11 +12,10 @@
 #include <QScrollBar>
 #include <QtWidgets/QToolTip>
 #include <CGAL/Constrained_Delaunay_triangulation_2.h>
-#include "functions.h"
 
 class CDTGraphicsView : public QGraphicsView {
 public:
-    CDTGraphicsView(CDT& cdt, Polygon& polygon, QWidget* parent = nullptr) 
+    CDTGraphicsView(Custom_CDT& cdt, Polygon& polygon, QWidget* parent = nullptr) 
         : QGraphicsView(parent), cdt(cdt), polygon(polygon) {
         // Initialize the scene and set it for this view
         QGraphicsScene* scene = new QGraphicsScene(this);
@@ -196,7 +197,7 @@ protected:
     }
 
 private:
-    CDT& cdt;
+    Custom_CDT& cdt;
     const Polygon& polygon;
     QPointF dragStartPos; // To store the position when dragging starts
     bool dragInProgress = false; // To track if dragging is happening
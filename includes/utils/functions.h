@@ -3,6 +3,11 @@
 
 #include "libraries.h"
 #include "ant.h"
+#include "thread_pool.h"
+#include "rng_context.h"
+#include "deadline.h"
+#include "buffered_writer.h"
+#include "steiner_snapping.h"
 
 using namespace boost::json;
 using namespace std;
@@ -32,16 +37,23 @@ void insert_centroid(Custom_CDT& centroid_cdt, const Face_handle& face, const Po
 bool is_circumcenter_in_neighbor(const Custom_CDT& cdt, const Face_handle& face, const Point_2& circumcenter);
 //Helper function for Midpoint (find the longest edge of a face)
 Segment_2 find_longest_edge(const Face_handle& face);
+//Index of the vertex of the face opposite to an edge of the face
+int opposite_vertex_index(const Face_handle& face, const Segment_2& edge);
 //Helper function for Adjacent Steiner
 bool has_obtuse_neighbors(const Custom_CDT& custom_cdt, const Face_handle& face, const Polygon& polygon);
 
 //Algorithms
-void local_search(Custom_CDT& custom_cdt, Polygon& polygon, int& L);
+void local_search(Custom_CDT& custom_cdt, Polygon& polygon, int& L, const Deadline& deadline = Deadline());
 void simulated_annealing(Custom_CDT& custom_cdt, Polygon& polygon, int max_iterations, const double& alpha, const double& beta, const int& batch_size);
+void simulated_annealing(Custom_CDT& custom_cdt, Polygon& polygon, int max_iterations, const double& alpha, const double& beta, const int& batch_size, std::mt19937& rng, bool verbose, const Deadline& deadline = Deadline());
+//Independent SA chains on num_of_chains threads, keeps the best
+void parallel_simulated_annealing(Custom_CDT& custom_cdt, Polygon& polygon, int max_iterations, const double& alpha, const double& beta, const int& batch_size, int num_of_chains, const Rng_context& rng_context, const Deadline& deadline = Deadline());
 void ant_colony(Custom_CDT& custom_cdt, Polygon& polygon, const double& alpha, const double& beta, const double& chi, const double& psi, const double& lamda, const int& L, const int& kappa);
+void ant_colony(Custom_CDT& custom_cdt, Polygon& polygon, const double& alpha, const double& beta, const double& chi, const double& psi, const double& lamda, const int& L, const int& kappa, int num_of_threads);
+void ant_colony(Custom_CDT& custom_cdt, Polygon& polygon, const double& alpha, const double& beta, const double& chi, const double& psi, const double& lamda, const int& L, const int& kappa, int num_of_threads, const Rng_context& rng_context, const Deadline& deadline = Deadline());
 
 //Helper functions for Simulated Annealing
-bool should_accept_bad_steiner(const double deltaE, const double T);
+bool should_accept_bad_steiner(const double deltaE, const double T, std::mt19937& rng);
 double calculate_energy(const int obtuse_faces, const int steiner_points, const double alpha, const double beta);
 
 //Helper functions for Ant Colony
@@ -50,27 +62,31 @@ double hta_vertex_projection(double rho);
 double hta_circumcenter(double rho);
 double hta_midpoint(double rho);
 double hta_mean_adjacent(bool has_obtuse_neighbors);
-Face_handle give_random_obtuse(Custom_CDT& custom_cdt, Polygon& polygon);
-SteinerMethod selectSteinerMethod(const double& ro, const vector<double>& taf, vector<double>& hta, double chi, double psi, bool obtuse_neighbors);
-void updatePheromones(vector<double>& taf, vector<double>& delta_taf, vector<Ant> selected_ants, double lamda);
-bool are_faces_equal(const Face_handle& face1, const Face_handle& face2);
+Face_handle give_random_obtuse(Custom_CDT& custom_cdt, Polygon& polygon, std::mt19937& generator);
+SteinerMethod selectSteinerMethod(const double& ro, const vector<double>& taf, vector<double>& hta, double chi, double psi, bool obtuse_neighbors, std::mt19937& gen);
+void updatePheromones(vector<double>& taf, vector<double>& delta_taf, const vector<Ant>& selected_ants, double lamda);
 vector<Ant> save_the_best(vector<Ant>& ants);
 //Check for conflict between 2 ants
 bool have_conflict(Ant& ant1, Ant& ant2);
 void printAntDetails(vector<Ant>& ants);
-void affected_faces(Custom_CDT& best_cdt, Ant& ant);
 
 /*General purpose functions*/
-void start_the_flips(Custom_CDT& cdt, const Polygon& polygon);
+//Flip until no edge is worth to flip, return the number of flips
+int start_the_flips(Custom_CDT& cdt, const Polygon& polygon);
+//Same after the insertion of a steiner (only its neighborhood is checked)
+int start_the_flips(Custom_CDT& cdt, const Polygon& polygon, Vertex_handle steiner);
+bool should_flip_edge(const Custom_CDT& cdt, const Face_handle& f1, int i, const Polygon& polygon);
 //Return true if approves the flip
 bool is_it_worth_flip(const Point_2& p1, const Point_2& p2, const Point_2& p3, const Point_2& p4);
 void update_polygon(Polygon& polygon, const Point_2& steiner_point, const Point_2& point1, const Point_2& point2);
 bool is_point_inside_region(const Point_2& point, const Polygon& polygon);
 bool is_face_inside_region(const Face_handle& face, const Polygon& polygon);
-//If an edge of the face lies into the border of the boundary, => face == face of boundary
-bool is_face_on_boundary(const Custom_CDT& cdt, Face_handle face, const Polygon& polygon);
+//Set the region flags of the faces, after the region boundary is inserted as constraints
+void mark_region_faces(Custom_CDT& cdt, const Polygon& polygon);
 bool is_edge_inside_region(const Point_2& point1, const Point_2& point2, const Polygon& polygon);
 bool is_edge_on_boundary(const Point_2& p1, const Point_2& p2, const Polygon& polygon);
+//Same for an edge of the cdt, with the region flags of its two faces
+bool is_edge_on_boundary(const Face_handle& face, int i);
 Point_2 compute_centroid(const vector<Point_2>& points);
 int count_vertices(const Custom_CDT& cdt);
 void print_polygon_edges(const Polygon& polygon);
@@ -80,7 +96,7 @@ bool is_obtuse(const Face_handle& face);
 //Check if a face (3 points) is obtuse
 bool is_obtuse2(const Point_2& p1, const Point_2& p2, const Point_2& p3);
 //Just count the number of obtuses triangles in a cdt
-int count_obtuse_triangles(CDT& cdt, const Polygon& polygon);
+int count_obtuse_triangles(Custom_CDT& cdt, const Polygon& polygon);
 //Return true if 2 faces (two triangles) form a convex polygon
 bool is_convex(const Point_2& p1, const Point_2& p2, const Point_2& p3, const Point_2& p4);
 Point_2 find_obtuse_vertex(const Point_2& v1, const Point_2& v2, const Point_2& v3);
@@ -88,8 +104,9 @@ Point_2 find_obtuse_vertex(const Point_2& v1, const Point_2& v2, const Point_2&
 
 //JSON INPUT - OUTPUT METHODS
 void read_json(const std_string& filename, value& jv);
-void output(value jv, Custom_CDT custom_cdt, vector<Point_2> points, int obtuse_count, std_string output_path);
-bool is_steiner_point(Vertex_handle vertex, const vector<Point_2>& original_points);
+bool output(const value& jv, const Custom_CDT& custom_cdt, const vector<Point_2>& points, int obtuse_count, const std_string& output_path);
+bool output(const value& jv, const Custom_CDT& custom_cdt, const vector<Point_2>& points, int obtuse_count, Buffered_writer& file);
+bool is_steiner_point(Vertex_handle vertex);
 std_string convert_to_string(const FT& coord);
 std_string format_double(double value);
 #endif
\ No newline at end of file
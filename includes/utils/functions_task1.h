@@ -1,7 +1,7 @@
+#include "includes/utils/Custom_Constrained_Delaunay_triangulation_2.h"
 #include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
 #include <CGAL/Exact_predicates_exact_constructions_kernel.h>
 #include <CGAL/Constrained_Delaunay_triangulation_2.h>
-#include <CGAL/draw_triangulation_2.h>
 #include <iostream>
 #include <vector>
 #include <stdio.h>
@@ -12,6 +12,8 @@
 #include <CGAL/Polygon_2.h>
 #include <CGAL/number_utils.h>
 #include "includes/utils/Custom_Constrained_Delaunay_triangulation_2.h"
+#include "includes/utils/deadline.h"
+#include "includes/utils/steiner_snapping.h"
 #include <CGAL/Line_2.h>
 #include <CGAL/squared_distance_2.h>
 #include <CGAL/number_utils.h>
@@ -46,7 +48,7 @@ bool is_in_constraints(const std::pair<int, int> &edge, const vector<std::pair<i
 bool is_in_region_boundary(const std::pair<int, int> &edge, const vector<Point> &boundary);
 
 //Just count the number of obtuses triangles in a cdt
-int count_obtuse_triangles_1(CDT &cdt, const Polygon &polygon);
+int count_obtuse_triangles_1(Custom_CDT &cdt, const Polygon &polygon);
 
 //Return true if 2 faces (two triangles) form a convex polygon
 bool is_convex_1(const Point_2 &p1, const Point_2 &p2, const Point_2 &p3, const Point_2 &p4);
@@ -54,7 +56,13 @@ bool is_convex_1(const Point_2 &p1, const Point_2 &p2, const Point_2 &p3, const
 //Return true if approves the flip
 bool can_flip(const Point_2 &p1, const Point_2 &p2, const Point_2 &p3, const Point_2 &p4);
 
-void start_the_flips_1(Custom_CDT &cdt, const Polygon &polygon);
+//Flip until no edge can be flipped, return the number of flips
+int start_the_flips_1(Custom_CDT &cdt, const Polygon &polygon);
+
+//Same after the insertion of a steiner (only its neighborhood is checked)
+int start_the_flips_1(Custom_CDT &cdt, const Polygon &polygon, Vertex_handle steiner);
+
+bool should_flip_edge_1(const Custom_CDT &cdt, const Face_handle &f1, int i, const Polygon &polygon);
 
 Point_2 find_obtuse_vertex_1(const Point_2 &v1, const Point_2 &v2, const Point_2 &v3);
 
@@ -72,6 +80,8 @@ bool is_point_inside_region(const Point_2 &point, const Polygon polygon);
 
 bool is_edge_in_boundary(const Point_2 &p1, const Point_2 &p2, const Polygon &polygon);
 
+bool is_edge_in_boundary(const Face_handle &face, int i);
+
 bool can_insert_centroid(Custom_CDT &custom_cdt, Face_handle &triangleA, const Point_2 &centroid, const Polygon &polygon);
 
 CGAL::Segment_2<K> find_longest_edge(const Point_2 &p1, const Point_2 &p2, const Point_2 &p3);
@@ -81,4 +91,4 @@ bool is_face_on_boundary(const Custom_CDT &cdt, Custom_CDT::Face_handle face);
 //JSON OUTPUT METHODS
 bool is_steiner_point(Vertex_handle vertex, const std::vector<Point_2> &original_points);
 
-void run_task1(Custom_CDT& custom_cdt, Polygon& polygon);
\ No newline at end of file
+void run_task1(Custom_CDT& custom_cdt, Polygon& polygon, const Deadline& deadline = Deadline());
\ No newline at end of file
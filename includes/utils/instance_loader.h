@@ -0,0 +1,17 @@
+//instance_loader.h
+#ifndef INSTANCE_LOADER_H
+#define INSTANCE_LOADER_H
+
+#include "solver.h"
+
+//Load an instance file without building the DOM of the whole json. The file is memory mapped and parsed with the
+//SAX parser of boost::json: points_x, points_y, region_boundary and additional_constraints go straight into the
+//vectors of the instance (reserved with num_points if the file has it), every other member (instance_uid, method,
+//delaunay, parameters, ...) is kept in instance.jv for the output.
+//Returns false with a message in error for a malformed instance (a missing or wrong member, different number of x and y,
+//an index of the region boundary out of range).
+bool load_instance(const std_string& input_path, Instance& instance, std_string& error);
+//The same for a json that is already in memory (size bytes from data)
+bool load_instance(const char* data, std::size_t size, Instance& instance, std_string& error);
+
+#endif
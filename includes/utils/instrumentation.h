@@ -0,0 +1,129 @@
+//instrumentation.h
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <atomic>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include "phase_timers.h"
+
+//Counters of the hot operations. They are compiled in only with the cmake option OPT_TRIANGULATION_INSTRUMENTATION,
+//otherwise INSTRUMENT_COUNT is empty. The counters are shared by all the threads of the process, so they belong to
+//one run (instrumentation_begin ... instrumentation_end) only if no other run counted at the same time.
+enum Counter {
+    COUNTER_OBTUSE_TESTS,           //obtuse_vertex_index (is_obtuse, the obtuse index of the cdt)
+    COUNTER_OBTUSE_EXACT,           //obtuse tests that needed the exact predicate
+    COUNTER_REGION_TESTS,           //is_face_inside_region
+    COUNTER_BOUNDED_SIDE,           //region tests of points and edges with polygon.bounded_side
+    COUNTER_FLIPS,                  //flips of start_the_flips
+    COUNTER_FLIP_EDGES_SCANNED,     //edges taken from the queue of start_the_flips
+    COUNTER_CDT_COPIES,             //copies of a Custom CDT
+    COUNTER_INSERT_NO_FLIP,         //insert_no_flip
+    NUM_COUNTERS
+};
+
+inline const char* counter_name(int counter) {
+    static const char* names[NUM_COUNTERS] = {"obtuse_tests", "obtuse_exact", "region_tests", "bounded_side",
+        "flips", "flip_edges_scanned", "cdt_copies", "insert_no_flip"};
+    return names[counter];
+}
+
+#ifdef OPT_TRIANGULATION_INSTRUMENTATION
+inline std::atomic<unsigned long long>* instrumentation_counters() {
+    static std::atomic<unsigned long long> counters[NUM_COUNTERS];
+    return counters;
+}
+#define INSTRUMENT_COUNT(counter) (instrumentation_counters()[counter].fetch_add(1, std::memory_order_relaxed))
+
+//The runs that count now, and how many runs started while another one was counting
+struct Instrumentation_runs {
+    std::mutex mutex;
+    int active = 0;
+    unsigned long long overlaps = 0;
+};
+
+inline Instrumentation_runs& instrumentation_runs() {
+    static Instrumentation_runs runs;
+    return runs;
+}
+
+//The run of the calling thread: if it started alone and the overlaps when it started
+struct Instrumentation_run {
+    bool alone = false;
+    unsigned long long overlaps = 0;
+};
+
+inline Instrumentation_run& instrumentation_run() {
+    thread_local Instrumentation_run run;
+    return run;
+}
+#else
+#define INSTRUMENT_COUNT(counter) ((void)0)
+#endif
+
+//Start of a run: zero the counters and measure the phases of the calling thread (only if the instrumentation is compiled in).
+//Every instrumentation_begin needs its instrumentation_end
+inline void instrumentation_begin() {
+#ifdef OPT_TRIANGULATION_INSTRUMENTATION
+    Instrumentation_runs& runs = instrumentation_runs();
+    Instrumentation_run& run = instrumentation_run();
+    {
+        std::lock_guard<std::mutex> lock(runs.mutex);
+        run.alone = runs.active++ == 0;
+        if (!run.alone) runs.overlaps++;
+        run.overlaps = runs.overlaps;
+        //The counters of a run that is not alone are not printed, so they are zeroed only for a run alone
+        if (run.alone) {
+            for (int counter = 0; counter < NUM_COUNTERS; ++counter) instrumentation_counters()[counter] = 0;
+        }
+    }
+    phase_times().reset();
+    phase_times().enabled = true;
+#endif
+}
+
+//End of the run of the calling thread
+inline void instrumentation_end() {
+#ifdef OPT_TRIANGULATION_INSTRUMENTATION
+    Instrumentation_runs& runs = instrumentation_runs();
+    std::lock_guard<std::mutex> lock(runs.mutex);
+    runs.active--;
+    phase_times().enabled = false;
+#endif
+}
+
+//JSON block with the counters and the phase times (of the calling thread, with OPT_TRIANGULATION_PHASE_TIMERS) since instrumentation_begin.
+//Empty object if the instrumentation is not compiled in, an error if another run counted at the same time
+//(f.e. the instances of a batch with -j > 1): the counters would have the operations of both
+inline std::string instrumentation_json() {
+    std::ostringstream json;
+    json<<"{";
+#ifdef OPT_TRIANGULATION_INSTRUMENTATION
+    const Instrumentation_run& run = instrumentation_run();
+    bool counted_alone;
+    {
+        Instrumentation_runs& runs = instrumentation_runs();
+        std::lock_guard<std::mutex> lock(runs.mutex);
+        counted_alone = run.alone && runs.overlaps == run.overlaps;
+    }
+    if (!counted_alone) {
+        json<<"\"error\": \"other runs were counted at the same time\"}";
+        return json.str();
+    }
+    json<<"\"counters\": {";
+    for (int counter = 0; counter < NUM_COUNTERS; ++counter) {
+        json<<(counter ? ", " : "")<<"\""<<counter_name(counter)<<"\": "<<instrumentation_counters()[counter].load();
+    }
+    json<<"}";
+#ifdef OPT_TRIANGULATION_PHASE_TIMERS
+    const Phase_times& times = phase_times();
+    json<<", \"phases\": {\"flips\": "<<times.seconds[PHASE_FLIPS]<<", \"counting\": "<<times.seconds[PHASE_COUNTING]
+        <<", \"insertion\": "<<times.seconds[PHASE_INSERTION]<<"}";
+#endif
+#endif
+    json<<"}";
+    return json.str();
+}
+
+#endif
@@ -7,7 +7,6 @@
 //CGAL headers
 #include <CGAL/Exact_predicates_exact_constructions_kernel.h>
 #include <CGAL/Constrained_Delaunay_triangulation_2.h>
-#include <CGAL/draw_triangulation_2.h>
 #include <CGAL/convex_hull_2.h>
 #include <CGAL/Polygon_2.h>
 #include <CGAL/number_utils.h>
@@ -19,10 +18,16 @@
 #include <iostream>
 #include <vector>
 #include <set>
+#include <unordered_set>
+#include <array>
+#include <algorithm>
 #include <string>
+#include <sstream>
+#include <limits>
 #include <cmath>
 #include <optional>
 #include <random>
+#include <thread>
 #include <fstream>
 #include <boost/json.hpp>
 
@@ -0,0 +1,46 @@
+//obtuse_predicate.h
+#ifndef OBTUSE_PREDICATE_H
+#define OBTUSE_PREDICATE_H
+
+#include <CGAL/Interval_nt.h>
+#include <CGAL/Uncertain.h>
+#include <CGAL/enum.h>
+#include <CGAL/number_utils.h>
+#include <CGAL/Kernel/global_functions_2.h>
+#include "instrumentation.h"
+
+//Filtered obtuse test for the points of a lazy exact kernel (Epeck).
+//Returns 0, 1 or 2 if the angle at a, b or c is obtuse and -1 if the triangle has no obtuse angle.
+//The angle at a vertex is obtuse when the dot product of its two edges is negative. The three dot products
+//are computed with interval arithmetic on the approximations of the points (no exact construction is forced)
+//and only if a sign is not certain we fall back to the exact CGAL::angle.
+template <class Point>
+int obtuse_vertex_index(const Point& a, const Point& b, const Point& c) {
+    INSTRUMENT_COUNT(COUNTER_OBTUSE_TESTS);
+    {
+        CGAL::Protect_FPU_rounding<true> protection;
+        const auto& pa = a.approx();
+        const auto& pb = b.approx();
+        const auto& pc = c.approx();
+        CGAL::Uncertain<CGAL::Sign> signs[3] = {
+            CGAL::sign((pb.x() - pa.x()) * (pc.x() - pa.x()) + (pb.y() - pa.y()) * (pc.y() - pa.y())),
+            CGAL::sign((pa.x() - pb.x()) * (pc.x() - pb.x()) + (pa.y() - pb.y()) * (pc.y() - pb.y())),
+            CGAL::sign((pa.x() - pc.x()) * (pb.x() - pc.x()) + (pa.y() - pc.y()) * (pb.y() - pc.y()))
+        };
+        //A triangle has at most one obtuse angle, so a certain negative sign is the answer
+        bool certain = true;
+        for (int i = 0; i < 3; ++i) {
+            if (!CGAL::is_certain(signs[i])) certain = false;
+            else if (CGAL::get_certain(signs[i]) == CGAL::NEGATIVE) return i;
+        }
+        if (certain) return -1;
+    }
+    //Exact fallback (out of the scope of the rounding mode)
+    INSTRUMENT_COUNT(COUNTER_OBTUSE_EXACT);
+    if (CGAL::angle(b, a, c) == CGAL::OBTUSE) return 0;
+    if (CGAL::angle(a, b, c) == CGAL::OBTUSE) return 1;
+    if (CGAL::angle(a, c, b) == CGAL::OBTUSE) return 2;
+    return -1;
+}
+
+#endif
@@ -0,0 +1,69 @@
+//phase_timers.h
+#ifndef PHASE_TIMERS_H
+#define PHASE_TIMERS_H
+
+#include <chrono>
+
+//Main phases of the algorithms
+enum Phase {
+    PHASE_FLIPS,
+    PHASE_COUNTING,
+    PHASE_INSERTION,
+    NUM_PHASES
+};
+
+//Time that the current thread spent in every phase. Nothing is measured until enabled is set (the benchmark does it).
+struct Phase_times {
+    bool enabled = false;
+    double seconds[NUM_PHASES] = {};
+    int depth[NUM_PHASES] = {};
+
+    void reset() {
+        for (int phase = 0; phase < NUM_PHASES; ++phase) seconds[phase] = 0.0;
+    }
+};
+
+inline Phase_times& phase_times() {
+    thread_local Phase_times times;
+    return times;
+}
+
+#ifdef OPT_TRIANGULATION_PHASE_TIMERS
+//Adds the time of its scope to a phase. Nested timers of the same phase (f.e. insert() that calls
+//insert_no_flip()) are counted once, by the outermost one.
+class Phase_timer {
+public:
+    explicit Phase_timer(Phase in_phase) : phase(in_phase) {
+        Phase_times& times = phase_times();
+        counted = times.enabled;
+        outermost = counted && times.depth[phase]++ == 0;
+        if (outermost) start = std::chrono::steady_clock::now();
+    }
+
+    ~Phase_timer() {
+        if (!counted) return;
+        Phase_times& times = phase_times();
+        times.depth[phase]--;
+        if (outermost) times.seconds[phase] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    Phase_timer(const Phase_timer&) = delete;
+    Phase_timer& operator=(const Phase_timer&) = delete;
+
+private:
+    Phase phase;
+    bool counted, outermost;
+    std::chrono::steady_clock::time_point start;
+};
+#else
+//Without OPT_TRIANGULATION_PHASE_TIMERS the phases are not measured (their times stay 0)
+class Phase_timer {
+public:
+    explicit Phase_timer(Phase) {}
+
+    Phase_timer(const Phase_timer&) = delete;
+    Phase_timer& operator=(const Phase_timer&) = delete;
+};
+#endif
+
+#endif
@@ -0,0 +1,134 @@
+//pool_allocator.h
+#ifndef POOL_ALLOCATOR_H
+#define POOL_ALLOCATOR_H
+
+#include <cstddef>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+//Thread local recycling of memory blocks for the triangulations (cmake -DOPT_TRIANGULATION_POOL=ON, off by default).
+//The metaheuristics copy and throw away triangulations all the time, and every copy allocates the same blocks again:
+//the blocks of the faces and the vertices (CGAL's Compact_container grows with blocks of the same sizes every time)
+//and the nodes of the sets of Custom_CDT. A freed block goes to a free list of its size in the thread that frees it
+//and the next allocation of that size takes it from there instead of malloc.
+//Every block is a separate allocation, so a block can be freed by another thread than the one that allocated it.
+//With OPT_TRIANGULATION_POOL the CGAL containers use Pool_allocator (CGAL_ALLOCATOR), so this header has to be
+//included before any CGAL header (Custom_Constrained_Delaunay_triangulation_2.h includes it first).
+
+class Block_pool {
+public:
+    //Small blocks (nodes) are rounded up to a multiple of 16 bytes, larger blocks are kept by their exact size
+    static constexpr std::size_t granule = 16;
+    static constexpr std::size_t small_classes = 16;
+    //Bytes of free blocks that a thread keeps, the rest go back to malloc
+    static constexpr std::size_t max_kept_bytes = std::size_t(64) << 20;
+
+    static void* allocate(std::size_t bytes) {
+#ifdef OPT_TRIANGULATION_POOL
+        if (!destroyed) {
+            Free_lists& lists = free_lists();
+            std::vector<void*>& list = lists.list_of(bytes);
+            if (!list.empty()) {
+                void* block = list.back();
+                list.pop_back();
+                lists.kept_bytes -= lists.rounded(bytes);
+                return block;
+            }
+            return ::operator new(lists.rounded(bytes));
+        }
+#endif
+        return ::operator new(bytes);
+    }
+
+    static void deallocate(void* block, std::size_t bytes) {
+#ifdef OPT_TRIANGULATION_POOL
+        if (!destroyed) {
+            Free_lists& lists = free_lists();
+            if (lists.kept_bytes + lists.rounded(bytes) <= max_kept_bytes) {
+                lists.list_of(bytes).push_back(block);
+                lists.kept_bytes += lists.rounded(bytes);
+                return;
+            }
+        }
+#endif
+        ::operator delete(block);
+    }
+
+private:
+    struct Free_lists {
+        std::vector<void*> small[small_classes];
+        std::unordered_map<std::size_t, std::vector<void*>> large;
+        std::size_t kept_bytes = 0;
+
+        static std::size_t rounded(std::size_t bytes) {
+            return bytes <= granule * small_classes ? (bytes + granule - 1) / granule * granule : bytes;
+        }
+
+        std::vector<void*>& list_of(std::size_t bytes) {
+            if (bytes <= granule * small_classes) return small[bytes == 0 ? 0 : (bytes - 1) / granule];
+            return large[bytes];
+        }
+
+        ~Free_lists() {
+            for (auto& list : small) {
+                for (void* block : list) ::operator delete(block);
+            }
+            for (auto& entry : large) {
+                for (void* block : entry.second) ::operator delete(block);
+            }
+            //Blocks freed later in this thread (by destructors of static objects) go straight to operator delete
+            destroyed = true;
+        }
+    };
+
+    static Free_lists& free_lists() {
+        thread_local Free_lists lists;
+        return lists;
+    }
+
+    static inline thread_local bool destroyed = false;
+};
+
+template <class T>
+struct Pool_allocator {
+    using value_type = T;
+
+    template <class U>
+    struct rebind {
+        using other = Pool_allocator<U>;
+    };
+
+    Pool_allocator() noexcept {}
+
+    template <class U>
+    Pool_allocator(const Pool_allocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "Pool_allocator gives the alignment of operator new");
+        return static_cast<T*>(Block_pool::allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* block, std::size_t n) noexcept {
+        Block_pool::deallocate(block, n * sizeof(T));
+    }
+};
+
+template <class T, class U>
+bool operator==(const Pool_allocator<T>&, const Pool_allocator<U>&) noexcept {
+    return true;
+}
+
+template <class T, class U>
+bool operator!=(const Pool_allocator<T>&, const Pool_allocator<U>&) noexcept {
+    return false;
+}
+
+#ifdef OPT_TRIANGULATION_POOL
+#ifdef CGAL_MEMORY_H
+#error "pool_allocator.h has to be included before the CGAL headers"
+#endif
+#define CGAL_ALLOCATOR(T) Pool_allocator< T >
+#endif
+
+#endif
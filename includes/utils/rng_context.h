@@ -0,0 +1,43 @@
+//rng_context.h
+#ifndef RNG_CONTEXT_H
+#define RNG_CONTEXT_H
+
+#include <random>
+#include <cstdint>
+
+//The seeded source of random numbers of a run. generator() is the main stream and split(stream) gives an independent
+//generator for a parallel part of the algorithm (a chain, an ant) which depends only on the seed and on the stream,
+//so a run is the same for the same seed no matter how many threads it uses or in which order they draw numbers.
+class Rng_context {
+public:
+    explicit Rng_context(unsigned int in_seed) : root_seed(in_seed), main_generator(make_generator(in_seed, 0)) {}
+
+    //Seed from the random device (for the runs without a seed)
+    static unsigned int random_seed() {
+        return std::random_device{}();
+    }
+
+    unsigned int seed() const {
+        return root_seed;
+    }
+
+    std::mt19937& generator() {
+        return main_generator;
+    }
+
+    //Stream 0 is the main stream
+    std::mt19937 split(std::uint64_t stream) const {
+        return make_generator(root_seed, stream);
+    }
+
+private:
+    static std::mt19937 make_generator(unsigned int seed, std::uint64_t stream) {
+        std::seed_seq sequence{seed, static_cast<unsigned int>(stream), static_cast<unsigned int>(stream >> 32)};
+        return std::mt19937(sequence);
+    }
+
+    unsigned int root_seed;
+    std::mt19937 main_generator;
+};
+
+#endif
@@ -0,0 +1,63 @@
+//solver.h
+#ifndef SOLVER_H
+#define SOLVER_H
+
+//API of the opttri library (no Qt): load an instance (read_instance, parse_instance or fill an Instance and set_method),
+//solve it (solve_instance or solve) and write the solution (write_solution). The functions print their errors to cerr.
+//If opttri is built with OPT_TRIANGULATION_POOL, a program that uses it has to define OPT_TRIANGULATION_POOL too and
+//include this header before any CGAL header: the pool replaces CGAL_ALLOCATOR, so the triangulation types
+//(and the functions of the library that take them) are different without it.
+
+#include "functions.h"
+
+//An instance as it is read from the input json
+struct Instance {
+    value jv;
+    vector<Point_2> points;
+    vector<pair<int, int>> additional_constraints;
+    vector<int> region_boundary;
+    std_string method;
+    bool delaunay = true;
+    double alpha = 2.2, beta = 0.1, chi = 3.0, psi = 1.0, lamda = 0.5, kappa = 5;
+    int L = 1230, batch_size = 5;
+    //Seed of the random numbers (parameter "seed", random if the input has no seed)
+    unsigned int seed = 0;
+    //Wall clock budget of the run in seconds (parameter "time_limit" or -t, <= 0 for no limit)
+    double time_limit = 0;
+    //Denominator of the snapped steiner points (parameter "snap_denominator", <= 0 for exact constructions)
+    long snap_denominator = 0;
+};
+
+//What a run gives back (for the summary of the batch runner)
+struct Solve_result {
+    int obtuse_count = -1;
+    int steiner_count = -1;
+    double wall_time = 0.0;
+};
+
+//Read and check the input json, false if the instance cannot be solved
+bool read_instance(const std_string& input_path, Instance& instance);
+//The same for the text of an input json that is already in memory
+bool parse_instance(const std_string& json_text, Instance& instance);
+//The same without printing, error is the reason of a wrong instance (for the answer of the daemon)
+bool parse_instance(const std_string& json_text, Instance& instance, std_string& error);
+//Replace the method ("local", "sa" or "ant") and its parameters (same members as the "parameters" of the input json)
+bool set_method(Instance& instance, const std_string& method, const object& parameters);
+//The time limit of the command line replaces the one of the input (if it is > 0)
+void set_time_limit(Instance& instance, double time_limit);
+//Build the constrained triangulation (points, additional constraints and region boundary) and the region polygon
+void build_triangulation(const Instance& instance, Custom_CDT& custom_cdt, Polygon& polygon);
+//Build the cdt of the instance and run its method, custom_cdt and polygon are the final triangulation and region.
+//verbose prints the progress of every iteration of the method
+Solve_result solve_instance(Instance& instance, Custom_CDT& custom_cdt, Polygon& polygon, int num_of_threads, bool verbose);
+//set_method and solve_instance, false (and no run) for a wrong method or parameters
+bool solve(Instance& instance, const std_string& method, const object& parameters, Custom_CDT& custom_cdt, Polygon& polygon, int num_of_threads, bool verbose, Solve_result& result);
+//Write the solution json of a solved instance (custom_cdt and result of solve_instance)
+bool write_solution(const Instance& instance, const Custom_CDT& custom_cdt, const Solve_result& result, const std_string& output_path);
+//Headless: solve and write the solution file of a single instance
+bool solve_file(const std_string& input_path, const std_string& output_path, int num_of_threads, double time_limit, bool verbose, Solve_result& result);
+//Solve every .json of input_dir (num_of_threads instances at a time), write one solution per input into output_dir
+//and the summary.csv with the obtuse count, the steiner count and the wall time of every instance
+int run_batch(const std_string& input_dir, const std_string& output_dir, int num_of_threads, double time_limit);
+
+#endif
@@ -0,0 +1,68 @@
+//steiner_snapping.h
+#ifndef STEINER_SNAPPING_H
+#define STEINER_SNAPPING_H
+
+#include <cmath>
+#include <CGAL/number_utils.h>
+#include <CGAL/Kernel_traits.h>
+
+//Snapping of the constructed steiner points (parameter "snap_denominator" of the input, kept in the cdt).
+//With the lazy exact constructions of Epeck a constructed point keeps the tree of the constructions that made it,
+//so the points that come from other steiner points get slower (and bigger) as the search goes deeper.
+//A snapped point is computed in double from the approximations and rounded to a rational with the given denominator,
+//then it is a new exact point without history. With a denominator <= 0 the points are returned as they are.
+
+//Round x to the nearest multiple of 1/denominator (exact rational)
+template <class FT>
+FT snap_coordinate(double x, long denominator) {
+    using ET = typename FT::ET;
+    return FT(ET(std::nearbyint(x * denominator)) / ET(static_cast<double>(denominator)));
+}
+
+//Any steiner point (circumcenter, centroid, ...)
+template <class Point>
+Point snap_point(const Point& p, long denominator) {
+    if (denominator <= 0) return p;
+    using FT = typename CGAL::Kernel_traits<Point>::Kernel::FT;
+    return Point(snap_coordinate<FT>(CGAL::to_double(p.x()), denominator), snap_coordinate<FT>(CGAL::to_double(p.y()), denominator));
+}
+
+//A point that has to stay exact (the midpoint of a constrained edge): the same value without the tree of the construction.
+//Its denominators are the ones of the edge (times 2)
+template <class Point>
+Point flatten_point(const Point& p, long denominator) {
+    if (denominator <= 0) return p;
+    using FT = typename CGAL::Kernel_traits<Point>::Kernel::FT;
+    return Point(FT(CGAL::exact(p.x())), FT(CGAL::exact(p.y())));
+}
+
+//A point p of the segment ab (a projection on a constrained edge): the parameter t of p = a + t(b - a) is snapped to a
+//multiple of 1/denominator strictly between 0 and 1, so the snapped point is still in the interior of the segment.
+//Its denominators are the ones of a and b times the denominator
+template <class Point>
+Point snap_on_segment(const Point& a, const Point& b, const Point& p, long denominator) {
+    if (denominator <= 1) return flatten_point(p, denominator);
+    using FT = typename CGAL::Kernel_traits<Point>::Kernel::FT;
+    using ET = typename FT::ET;
+    double ax = CGAL::to_double(a.x()), ay = CGAL::to_double(a.y());
+    double dx = CGAL::to_double(b.x()) - ax, dy = CGAL::to_double(b.y()) - ay;
+    double t = ((CGAL::to_double(p.x()) - ax) * dx + (CGAL::to_double(p.y()) - ay) * dy) / (dx * dx + dy * dy);
+    double steps = std::nearbyint(t * denominator);
+    if (steps < 1) steps = 1;
+    if (steps > denominator - 1) steps = static_cast<double>(denominator - 1);
+    ET exact_t = ET(steps) / ET(static_cast<double>(denominator));
+    const ET& exact_ax = CGAL::exact(a.x());
+    const ET& exact_ay = CGAL::exact(a.y());
+    return Point(FT(exact_ax + exact_t * (CGAL::exact(b.x()) - exact_ax)), FT(exact_ay + exact_t * (CGAL::exact(b.y()) - exact_ay)));
+}
+
+//A steiner point of the edge (face, i) (a midpoint or a projection). A constrained edge (also the region boundary) has to be
+//split by a point of the edge, there the point stays exact (flatten_point or snap_on_segment) and its denominators grow
+//with the ones of the edge. A point of another edge is snapped with snap_point like the other steiner points: it lands
+//on the edge or next to it (in one of its two faces), so it is inserted by its location
+template <class CDT>
+bool snaps_off_edge(const CDT& cdt, const typename CDT::Face_handle& face, int i) {
+    return cdt.snap_denominator() > 0 && !cdt.is_constrained(typename CDT::Edge(face, i));
+}
+
+#endif
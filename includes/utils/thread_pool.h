@@ -0,0 +1,87 @@
+//thread_pool.h
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Fixed set of worker threads for loops with independent iterations.
+//With 1 thread (or less) there are no workers and parallel_for runs the loop in the calling thread.
+//The workers of the metaheuristics share the points of the triangulations: the points of Epeck are lazy, so a
+//predicate in one thread can compute the exact value of a point that another thread reads at the same time.
+//This needs a CGAL whose lazy evaluation is thread safe: CGAL 5.6 or newer (CMakeLists.txt requires it) with
+//CGAL_HAS_THREADS (the default, functions.cpp stops the build with CGAL_HAS_NO_THREADS).
+class Thread_pool {
+public:
+    explicit Thread_pool(int num_of_threads) {
+        for (int worker = 0; num_of_threads > 1 && worker < num_of_threads; ++worker) {
+            workers.emplace_back([this, worker](){ work(worker); });
+        }
+    }
+
+    ~Thread_pool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    Thread_pool(const Thread_pool&) = delete;
+    Thread_pool& operator=(const Thread_pool&) = delete;
+
+    //Number of workers (1 when the loops run in the calling thread)
+    int size() const {
+        return workers.empty() ? 1 : static_cast<int>(workers.size());
+    }
+
+    //Call task(i, worker) for every i in [0, n), worker is in [0, size()). Returns when all the calls are done
+    void parallel_for(int n, const std::function<void(int, int)>& in_task) {
+        if (workers.empty()) {
+            for (int i = 0; i < n; ++i) in_task(i, 0);
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        task = in_task;
+        next_index = 0;
+        end_index = n;
+        active_workers = static_cast<int>(workers.size());
+        generation++;
+        wake.notify_all();
+        done.wait(lock, [this](){ return active_workers == 0; });
+        task = nullptr;
+    }
+
+private:
+    void work(int worker) {
+        unsigned long seen_generation = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [&](){ return stop || generation != seen_generation; });
+            if (stop) return;
+            seen_generation = generation;
+            //Take the next index until the loop is over
+            while (next_index < end_index) {
+                int i = next_index++;
+                lock.unlock();
+                task(i, worker);
+                lock.lock();
+            }
+            if (--active_workers == 0) done.notify_all();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    std::function<void(int, int)> task;
+    int next_index = 0, end_index = 0, active_workers = 0;
+    unsigned long generation = 0;
+    bool stop = false;
+};
+
+#endif
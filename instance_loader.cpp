@@ -0,0 +1,304 @@
+#include "includes/utils/instance_loader.h"
+#include <boost/json/basic_parser_impl.hpp>
+#include <cstdint>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+using std_string = std::string;
+namespace bj = boost::json;
+
+namespace {
+
+//Read only mapping of a whole file
+class Mapped_file {
+public:
+    explicit Mapped_file(const std_string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat info;
+        if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* address = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address != MAP_FAILED) {
+                ::madvise(address, info.st_size, MADV_SEQUENTIAL);
+                data = static_cast<const char*>(address);
+                size = info.st_size;
+            }
+        }
+        ::close(fd);
+    }
+
+    ~Mapped_file() {
+        if (data) ::munmap(const_cast<char*>(data), size);
+    }
+
+    Mapped_file(const Mapped_file&) = delete;
+    Mapped_file& operator=(const Mapped_file&) = delete;
+
+    const char* data = nullptr;
+    std::size_t size = 0;
+};
+
+//SAX handler. The four big arrays of the instance are parsed into vectors, the rest of the members are built as json values.
+class Instance_handler {
+public:
+    static constexpr std::size_t max_object_size = std::size_t(-1);
+    static constexpr std::size_t max_array_size = std::size_t(-1);
+    static constexpr std::size_t max_key_size = std::size_t(-1);
+    static constexpr std::size_t max_string_size = std::size_t(-1);
+
+    //Arrays that are parsed straight into vectors
+    enum Target { NONE, POINTS_X, POINTS_Y, REGION_BOUNDARY, ADDITIONAL_CONSTRAINTS };
+
+    vector<double> xs, ys;
+    vector<int> region_boundary;
+    vector<pair<int, int>> additional_constraints;
+    bj::object members;
+    bool seen[5] = {};
+    std_string error;
+
+    bool on_document_begin(bj::error_code&) { return true; }
+    bool on_document_end(bj::error_code&) { return true; }
+
+    bool on_object_begin(bj::error_code& ec) {
+        if (target != NONE) return fail(ec, "unexpected object in " + key);
+        if (depth++ == 0) return true;
+        stack.emplace_back(bj::object());
+        return true;
+    }
+
+    bool on_object_end(std::size_t, bj::error_code&) {
+        if (--depth == 0) return true;
+        return end_value();
+    }
+
+    bool on_array_begin(bj::error_code& ec) {
+        if (depth == 0) return fail(ec, "the instance is not an object");
+        if (target == ADDITIONAL_CONSTRAINTS && depth == 2) {
+            //A constraint [i, j]
+            depth++;
+            constraint_size = 0;
+            return true;
+        }
+        if (target != NONE) return fail(ec, "unexpected array in " + key);
+        if (depth == 1 && stack.empty()) {
+            target = target_of(key);
+            if (target != NONE) {
+                if (seen[target]) return fail(ec, "duplicate member " + key);
+                seen[target] = true;
+                depth++;
+                return true;
+            }
+        }
+        depth++;
+        stack.emplace_back(bj::array());
+        return true;
+    }
+
+    bool on_array_end(std::size_t, bj::error_code& ec) {
+        depth--;
+        if (target == ADDITIONAL_CONSTRAINTS && depth == 2) {
+            if (constraint_size != 2) return fail(ec, "a constraint is not a pair of indices");
+            return true;
+        }
+        if (target != NONE) {
+            target = NONE;
+            return true;
+        }
+        return end_value();
+    }
+
+    bool on_key_part(bj::string_view s, std::size_t, bj::error_code&) {
+        key_part.append(s.data(), s.size());
+        return true;
+    }
+
+    bool on_key(bj::string_view s, std::size_t, bj::error_code&) {
+        key_part.append(s.data(), s.size());
+        if (stack.empty()) key = key_part;
+        else keys.push_back(key_part);
+        key_part.clear();
+        return true;
+    }
+
+    bool on_string_part(bj::string_view s, std::size_t, bj::error_code&) {
+        string_part.append(s.data(), s.size());
+        return true;
+    }
+
+    bool on_string(bj::string_view s, std::size_t, bj::error_code& ec) {
+        string_part.append(s.data(), s.size());
+        bj::value value(string_part);
+        string_part.clear();
+        if (target != NONE) return fail(ec, "string in " + key);
+        return add_value(std::move(value));
+    }
+
+    bool on_number_part(bj::string_view, bj::error_code&) { return true; }
+
+    bool on_int64(std::int64_t i, bj::string_view, bj::error_code& ec) {
+        if (target != NONE) return add_number(static_cast<double>(i), true, i, ec);
+        if (stack.empty() && key == "num_points" && i > 0) {
+            xs.reserve(i);
+            ys.reserve(i);
+        }
+        return add_value(bj::value(i));
+    }
+
+    bool on_uint64(std::uint64_t u, bj::string_view, bj::error_code& ec) {
+        if (target != NONE) return add_number(static_cast<double>(u), true, static_cast<std::int64_t>(u), ec);
+        return add_value(bj::value(u));
+    }
+
+    bool on_double(double d, bj::string_view, bj::error_code& ec) {
+        if (target != NONE) return add_number(d, false, 0, ec);
+        return add_value(bj::value(d));
+    }
+
+    bool on_bool(bool b, bj::error_code& ec) {
+        if (target != NONE) return fail(ec, "bool in " + key);
+        return add_value(bj::value(b));
+    }
+
+    bool on_null(bj::error_code& ec) {
+        if (target != NONE) return fail(ec, "null in " + key);
+        return add_value(bj::value(nullptr));
+    }
+
+    bool on_comment_part(bj::string_view, bj::error_code&) { return true; }
+    bool on_comment(bj::string_view, bj::error_code&) { return true; }
+
+private:
+    static Target target_of(const std_string& key) {
+        if (key == "points_x") return POINTS_X;
+        if (key == "points_y") return POINTS_Y;
+        if (key == "region_boundary") return REGION_BOUNDARY;
+        if (key == "additional_constraints") return ADDITIONAL_CONSTRAINTS;
+        return NONE;
+    }
+
+    bool fail(bj::error_code& ec, const std_string& message) {
+        error = message;
+        ec = bj::error::syntax;
+        return false;
+    }
+
+    //A number of one of the big arrays
+    bool add_number(double d, bool is_integer, std::int64_t i, bj::error_code& ec) {
+        switch (target) {
+            case POINTS_X: xs.push_back(d); return true;
+            case POINTS_Y: ys.push_back(d); return true;
+            case REGION_BOUNDARY:
+                if (!is_integer || i < 0 || i > INT32_MAX) return fail(ec, "wrong index in region_boundary");
+                region_boundary.push_back(i);
+                return true;
+            case ADDITIONAL_CONSTRAINTS:
+                if (depth != 3) return fail(ec, "a constraint is not a pair of indices");
+                if (!is_integer || i < 0 || i > INT32_MAX || constraint_size >= 2) return fail(ec, "wrong index in additional_constraints");
+                if (constraint_size++ == 0) additional_constraints.emplace_back(i, -1);
+                else additional_constraints.back().second = i;
+                return true;
+            default: return true;
+        }
+    }
+
+    //A value of a member that is kept in the json
+    bool add_value(bj::value value) {
+        if (stack.empty()) {
+            members[key] = std::move(value);
+            return true;
+        }
+        bj::value& parent = stack.back();
+        if (parent.is_object()) {
+            parent.as_object()[keys.back()] = std::move(value);
+            keys.pop_back();
+        }
+        else parent.as_array().push_back(std::move(value));
+        return true;
+    }
+
+    bool end_value() {
+        bj::value value = std::move(stack.back());
+        stack.pop_back();
+        return add_value(std::move(value));
+    }
+
+    int depth = 0;
+    Target target = NONE;
+    int constraint_size = 0;
+    std_string key, key_part, string_part;
+    vector<bj::value> stack;
+    vector<std_string> keys;
+};
+
+}
+
+bool load_instance(const std_string& input_path, Instance& instance, std_string& error) {
+    Mapped_file file(input_path);
+    if (!file.data) {
+        error = "cannot read " + input_path;
+        return false;
+    }
+    return load_instance(file.data, file.size, instance, error);
+}
+
+bool load_instance(const char* data, std::size_t size, Instance& instance, std_string& error) {
+    bj::basic_parser<Instance_handler> parser(bj::parse_options{});
+    bj::error_code ec;
+    std::size_t consumed = parser.write_some(false, data, size, ec);
+    Instance_handler& handler = parser.handler();
+    if (ec) {
+        error = handler.error.empty() ? ec.message() : handler.error;
+        return false;
+    }
+    //The parser stops after the first json value, anything after it (or a cut value) is a wrong instance
+    if (!parser.done() || consumed != size) {
+        error = parser.done() ? "extra data after the instance" : "incomplete instance";
+        return false;
+    }
+
+    //Check the instance
+    static const char* arrays[] = {"", "points_x", "points_y", "region_boundary", "additional_constraints"};
+    for (int target = Instance_handler::POINTS_X; target <= Instance_handler::ADDITIONAL_CONSTRAINTS; ++target) {
+        if (!handler.seen[target]) {
+            error = std_string("missing ") + arrays[target];
+            return false;
+        }
+    }
+    if (handler.xs.size() != handler.ys.size()) {
+        error = "points_x and points_y have different sizes";
+        return false;
+    }
+    int number_of_points = handler.xs.size();
+    for (int index : handler.region_boundary) {
+        if (index >= number_of_points) {
+            error = "index of region_boundary out of range";
+            return false;
+        }
+    }
+    for (const char* member : {"instance_uid", "method", "parameters", "delaunay"}) {
+        if (!handler.members.contains(member)) {
+            error = std_string("missing ") + member;
+            return false;
+        }
+    }
+    if (!handler.members.at("instance_uid").is_string() || !handler.members.at("method").is_string()
+        || !handler.members.at("parameters").is_object() || !handler.members.at("delaunay").is_bool()) {
+        error = "wrong type of instance_uid, method, parameters or delaunay";
+        return false;
+    }
+
+    instance.points.clear();
+    instance.points.reserve(number_of_points);
+    for (int i = 0; i < number_of_points; ++i) instance.points.emplace_back(handler.xs[i], handler.ys[i]);
+    instance.region_boundary = std::move(handler.region_boundary);
+    //The constraints with an index out of range are ignored
+    instance.additional_constraints.clear();
+    for (const auto& constraint : handler.additional_constraints) {
+        if (constraint.first < number_of_points && constraint.second < number_of_points) instance.additional_constraints.push_back(constraint);
+    }
+    instance.jv = std::move(handler.members);
+    return true;
+}
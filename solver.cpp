@@ -0,0 +1,278 @@
+#include "includes/utils/solver.h"
+#include "includes/utils/functions_task1.h"
+#include "includes/utils/instance_loader.h"
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+
+using namespace boost::json;
+using namespace std;
+using K = CGAL::Exact_predicates_exact_constructions_kernel;
+using Custom_CDT = Custom_Constrained_Delaunay_triangulation_2<K>;
+using Point_2 = K::Point_2;
+using std_string = std::string;
+namespace fs = std::filesystem;
+
+//Method, delaunay and parameters of the instance from the members of jv
+static bool read_parameters(Instance& instance) {
+    const auto& obj = instance.jv.as_object();
+    instance.method = std_string(obj.at("method").as_string());
+    const auto& parameters_obj = obj.at("parameters").as_object();
+    instance.delaunay = obj.at("delaunay").as_bool();
+    instance.L = parameters_obj.at("L").as_int64();
+    if (parameters_obj.contains("time_limit")) instance.time_limit = parameters_obj.at("time_limit").to_number<double>();
+    if (parameters_obj.contains("snap_denominator")) instance.snap_denominator = static_cast<long>(parameters_obj.at("snap_denominator").as_int64());
+    //Without a seed we draw one and add it to the parameters, so that it is written in the output and the run can be repeated
+    if (parameters_obj.contains("seed")) instance.seed = static_cast<unsigned int>(parameters_obj.at("seed").as_int64());
+    else {
+        instance.seed = Rng_context::random_seed();
+        instance.jv.as_object()["parameters"].as_object()["seed"] = static_cast<std::int64_t>(instance.seed);
+    }
+
+    //Parameters of the chosen method
+    if (instance.method == "sa") {
+        instance.alpha = parameters_obj.at("alpha").as_double();
+        instance.beta = parameters_obj.at("beta").as_double();
+        //How many "bad" steiners we accept to insert, until we will try again to add steiners in the best_cdt
+        instance.batch_size = parameters_obj.at("batch_size").as_int64();
+    }
+    else if (instance.method == "ant") {
+        instance.alpha = parameters_obj.at("alpha").as_double();
+        instance.beta = parameters_obj.at("beta").as_double();
+        instance.lamda = parameters_obj.at("lambda").as_double();
+        instance.chi = parameters_obj.at("xi").as_double();
+        instance.psi = parameters_obj.at("psi").as_double();
+        instance.kappa = parameters_obj.at("kappa").as_int64();
+    }
+    else if (instance.method != "local") {
+        cerr<<"Error: wrong method"<<endl;
+        return false;
+    }
+
+    return true;
+}
+
+//Read and check the input json
+bool read_instance(const std_string& input_path, Instance& instance) {
+    //The points and the constraints are loaded into the instance, jv has the rest of the members
+    std_string error;
+    if (!load_instance(input_path, instance, error)) {
+        cerr<<"Wrong instance "<<input_path<<": "<<error<<endl;
+        return false;
+    }
+    return read_parameters(instance);
+}
+
+//The same for a json in memory
+bool parse_instance(const std_string& json_text, Instance& instance) {
+    std_string error;
+    if (!parse_instance(json_text, instance, error)) {
+        cerr<<"Wrong instance: "<<error<<endl;
+        return false;
+    }
+    return true;
+}
+
+//Without printing, error is the reason of a wrong instance
+bool parse_instance(const std_string& json_text, Instance& instance, std_string& error) {
+    if (!load_instance(json_text.data(), json_text.size(), instance, error)) return false;
+    if (!read_parameters(instance)) {
+        error = "wrong method";
+        return false;
+    }
+    return true;
+}
+
+//Replace the method and the parameters of the instance
+bool set_method(Instance& instance, const std_string& method, const object& parameters) {
+    auto& obj = instance.jv.as_object();
+    obj["method"] = method;
+    obj["parameters"] = parameters;
+    return read_parameters(instance);
+}
+
+//The time limit of the command line replaces the one of the input
+void set_time_limit(Instance& instance, double time_limit) {
+    if (time_limit > 0) instance.time_limit = time_limit;
+}
+
+//Build the constrained triangulation of the instance and its region
+void build_triangulation(const Instance& instance, Custom_CDT& custom_cdt, Polygon& polygon) {
+    const vector<Point_2>& points = instance.points;
+    const vector<int>& region_boundary = instance.region_boundary;
+
+    //Create a polygon from region boundary
+    polygon.clear();
+    for (int index : region_boundary) {
+        polygon.push_back(points[index]);
+    }
+
+    //Make the cdt (spatially sorted), the vertices of the input keep the index of their point
+    custom_cdt = Custom_CDT();
+    custom_cdt.set_snap_denominator(instance.snap_denominator);
+    vector<Vertex_handle> vertices = custom_cdt.insert_points(points);
+
+    //Insert the additional constraints and the region boundary together, then mark the faces inside of the region
+    vector<pair<int, int>> constraints = instance.additional_constraints;
+    for (int i = 0; i < region_boundary.size(); ++i) {
+        int next = (i + 1) % region_boundary.size();
+        constraints.emplace_back(region_boundary[i], region_boundary[next]);
+    }
+    custom_cdt.insert_constraints(vertices, constraints);
+    mark_region_faces(custom_cdt, polygon);
+}
+
+//Build the cdt of the instance and run its method
+Solve_result solve_instance(Instance& instance, Custom_CDT& custom_cdt, Polygon& polygon, int num_of_threads, bool verbose) {
+    Solve_result result;
+    auto start = chrono::steady_clock::now();
+    //The budget starts with the construction of the triangulation
+    Deadline deadline(instance.time_limit);
+    Rng_context rng_context(instance.seed);
+    instrumentation_begin();
+    cout<<"seed: "<<instance.seed<<endl;
+    Custom_CDT initial_cdt;
+    Polygon region;
+    build_triangulation(instance, initial_cdt, region);
+
+    int obtuses_faces = count_obtuse_triangles(initial_cdt, region);
+    int init_obtuse_faces = obtuses_faces;
+    int initial_vertexes = count_vertices(initial_cdt);
+    cout<<"Initial number of obtuses: "<<obtuses_faces<<endl;
+    cout<<"Initial number of vertexes: "<<initial_vertexes<<endl;
+    double success;
+
+    custom_cdt = initial_cdt;
+    //Run task1 if delaunay parameter is false
+    if (!instance.delaunay) {
+        cout<<"**Run task1**"<<endl;
+        run_task1(custom_cdt, region, deadline);
+        obtuses_faces = count_obtuse_triangles(custom_cdt, region);
+        cout<<"Number of obtuses after task 1: "<<obtuses_faces<<endl;
+        cout<<"Sum of steiners after task 1: "<<count_vertices(custom_cdt) - initial_vertexes<<endl;
+        if (init_obtuse_faces > 0) success = ((double)obtuses_faces/(double)init_obtuse_faces)*100;
+        cout<<100-success<<"%"<<" obtuse triangles reduction success after task 1"<<endl;
+    }
+
+    polygon = region;
+
+    //Flips
+    start_the_flips(custom_cdt, polygon);
+
+    //Local Search
+    if (instance.method == "local") {
+        cout<<"Local Search is starting.."<<endl;
+        local_search(custom_cdt, polygon, instance.L, deadline);
+        cout <<"**Number of Obtuses after from Local Search: "<<count_obtuse_triangles(custom_cdt, polygon)<<" **"<<endl;
+    }
+
+    //SA
+    if (instance.method == "sa") {
+        cout<<"Simulated Annealing is starting.. "<<endl;
+        if (num_of_threads > 1) parallel_simulated_annealing(custom_cdt, polygon, instance.L, instance.alpha, instance.beta, instance.batch_size, num_of_threads, rng_context, deadline);
+        else simulated_annealing(custom_cdt, polygon, instance.L, instance.alpha, instance.beta, instance.batch_size, rng_context.generator(), verbose, deadline);
+        cout <<"**Number of Obtuses after from Simulated Annealing: "<<count_obtuse_triangles(custom_cdt, polygon)<<" **"<<endl;
+    }
+    //Ant Colony
+    if (instance.method == "ant") {
+        cout<<"Ant Colony is starting.. "<<endl;
+        ant_colony(custom_cdt, polygon, instance.alpha, instance.beta, instance.chi, instance.psi, instance.lamda, instance.L, instance.kappa, num_of_threads, rng_context, deadline);
+        cout <<"**Number of Obtuses after from Ant Colony: "<<count_obtuse_triangles(custom_cdt, polygon)<<" **"<<endl;
+    }
+    obtuses_faces = count_obtuse_triangles(custom_cdt, polygon);
+    cout<<"Sum of steiners: "<<count_vertices(custom_cdt) - initial_vertexes<<endl;
+    if (init_obtuse_faces > 0) success = ((double)obtuses_faces/(double)init_obtuse_faces)*100;
+    cout<<100-success<<"%"<<" obtuse triangles reduction success"<<endl;
+
+#ifdef OPT_TRIANGULATION_INSTRUMENTATION
+    //The counters are shared by the threads, in a batch run with -j > 1 they are not printed (see instrumentation.h)
+    cout<<"instrumentation: "<<instrumentation_json()<<endl;
+#endif
+    instrumentation_end();
+
+    result.obtuse_count = obtuses_faces;
+    result.steiner_count = count_vertices(custom_cdt) - initial_vertexes;
+    result.wall_time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+//Run an other method (and parameters) on a loaded instance
+bool solve(Instance& instance, const std_string& method, const object& parameters, Custom_CDT& custom_cdt, Polygon& polygon, int num_of_threads, bool verbose, Solve_result& result) {
+    if (!set_method(instance, method, parameters)) return false;
+    result = solve_instance(instance, custom_cdt, polygon, num_of_threads, verbose);
+    return true;
+}
+
+//Write the solution of a solved instance
+bool write_solution(const Instance& instance, const Custom_CDT& custom_cdt, const Solve_result& result, const std_string& output_path) {
+    return output(instance.jv, custom_cdt, instance.points, result.obtuse_count, output_path);
+}
+
+//Headless: solve and write the solution file of a single instance
+bool solve_file(const std_string& input_path, const std_string& output_path, int num_of_threads, double time_limit, bool verbose, Solve_result& result) {
+    Instance instance;
+    if (!read_instance(input_path, instance)) return false;
+    set_time_limit(instance, time_limit);
+    cout<<"method: "<<instance.method<<endl;
+    Custom_CDT custom_cdt;
+    Polygon polygon;
+    result = solve_instance(instance, custom_cdt, polygon, num_of_threads, verbose);
+    return write_solution(instance, custom_cdt, result, output_path);
+}
+
+//Solve every .json of input_dir
+int run_batch(const std_string& input_dir, const std_string& output_dir, int num_of_threads, double time_limit) {
+    vector<fs::path> inputs;
+    error_code error;
+    for (const auto& entry : fs::directory_iterator(input_dir, error)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".json") inputs.push_back(entry.path());
+    }
+    if (error) {
+        cerr<<"Cannot read the directory "<<input_dir<<": "<<error.message()<<endl;
+        return 1;
+    }
+    sort(inputs.begin(), inputs.end());
+    fs::create_directories(output_dir, error);
+    if (error) {
+        cerr<<"Cannot create the directory "<<output_dir<<": "<<error.message()<<endl;
+        return 1;
+    }
+
+    //The instances are the unit of parallelism, so every instance runs its method with 1 thread (and without the
+    //progress of every iteration, the outputs of the instances are mixed)
+    vector<Solve_result> results(inputs.size());
+    vector<char> solved(inputs.size(), false);
+    mutex print_mutex;
+    Thread_pool pool(num_of_threads);
+    pool.parallel_for(inputs.size(), [&](int i, int worker){
+        fs::path output_path = fs::path(output_dir) / inputs[i].filename();
+        try {
+            solved[i] = solve_file(inputs[i].string(), output_path.string(), 1, time_limit, false, results[i]);
+        }
+        catch (const exception& e) {
+            lock_guard<mutex> lock(print_mutex);
+            cerr<<"Error in "<<inputs[i]<<": "<<e.what()<<endl;
+        }
+        lock_guard<mutex> lock(print_mutex);
+        cout<<"Done "<<inputs[i].filename()<<(solved[i] ? "" : " (failed)")<<endl;
+    });
+
+    //Summary (a failed instance has -1 counts)
+    fs::path summary_path = fs::path(output_dir) / "summary.csv";
+    ofstream summary(summary_path);
+    if (!summary) {
+        cerr<<"Cannot write "<<summary_path<<endl;
+        return 1;
+    }
+    int failed = 0;
+    summary<<"instance,obtuse_count,steiner_count,wall_time"<<endl;
+    for (int i = 0; i < inputs.size(); ++i) {
+        if (!solved[i]) {
+            results[i] = Solve_result();
+            failed++;
+        }
+        summary<<inputs[i].filename().string()<<","<<results[i].obtuse_count<<","<<results[i].steiner_count<<","<<results[i].wall_time<<endl;
+    }
+    cout<<"Solved "<<inputs.size() - failed<<"/"<<inputs.size()<<" instances, summary: "<<summary_path.string()<<endl;
+    return failed > 0 ? 1 : 0;
+}